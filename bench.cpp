@@ -0,0 +1,380 @@
+/**
+ * @file bench.cpp
+ * @brief Benchmark delle fasi della costruzione del suffix array su un insieme di file.
+ *
+ * Per ogni file (oppure per ogni testo sintetico di una serie generata con generator.hpp) e ogni
+ * ripetizione misura lettura, fattorizzazione, la costruzione di riferimento con SA-IS, build_tree, calcolo
+ * degli insertion target, assemblaggio con build_suffix_array, verifica (con --verify), array LCP, FM-index
+ * e assemblaggio con build_list, e stampa una riga per fase nel formato
+ *
+ *     RESULT input=<file> n=<caratteri> k=<fattori> threads=<t> run=<r> phase=<fase> time_ms=<ms>
+ *            peak_bytes=<byte> retained_bytes=<byte> mallocs=<chiamate> frees=<chiamate> mb_per_s=<MB/s>
+ *
+ * (su un'unica riga), leggibile da sqlplot-tools o da un semplice parser chiave=valore. peak_bytes e' il
+ * picco di memoria heap allocata durante la fase oltre a quella gia' allocata al suo inizio; retained_bytes
+ * la memoria ancora allocata alla fine della fase. La memoria e' misurata da pasta::MemoryMonitor tramite
+ * la sostituzione di malloc/free (pasta/utils/benchmark/malloc.cpp), che non e' sincronizzata: con piu'
+ * thread i contatori sono approssimati. I file mappati in memoria non sono memoria heap e non vengono contati.
+ */
+
+#include "func.hpp"
+#include "fm_index.hpp"
+#include "generator.hpp"
+#include "mapped_file.hpp"
+
+#include <pasta/utils/benchmark/do_not_optimize.hpp>
+#include <pasta/utils/benchmark/memory_monitor.hpp>
+#include <pasta/utils/benchmark/timer.hpp>
+#include <tlx/cmdline_parser.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class PhaseReporter
+ * @brief Misura tempo e memoria delle fasi di un'esecuzione e le stampa come righe RESULT.
+ */
+class PhaseReporter {
+
+private:
+    std::string _input; ///< File di input.
+    uint64_t _n; ///< Lunghezza del testo (0 finche' non e' nota).
+    uint64_t _k; ///< Numero di fattori (0 finche' non e' noto).
+    unsigned int _threads; ///< Numero di thread.
+    std::size_t _run; ///< Indice della ripetizione.
+
+public:
+    /**
+     * @brief Costruttore.
+     * @param input File di input.
+     * @param threads Numero di thread.
+     * @param run Indice della ripetizione.
+     */
+    PhaseReporter(std::string input, unsigned int threads, std::size_t run)
+            : _input(std::move(input)), _n(0), _k(0), _threads(threads), _run(run) {}
+
+    /**
+     * @brief Imposta le dimensioni dell'input, riportate nelle righe successive.
+     * @param n Lunghezza del testo.
+     * @param k Numero di fattori.
+     */
+    void set_size(uint64_t n, uint64_t k) {
+        _n = n;
+        _k = k;
+    }
+
+    /**
+     * @brief Esegue una fase misurandone tempo, picco di memoria e chiamate a malloc/free.
+     * @tparam Function Tipo della fase, che restituisce un valore.
+     * @param phase Nome della fase.
+     * @param bytes Byte elaborati dalla fase, per il calcolo del throughput.
+     * @param function Fase da eseguire.
+     * @return Il valore restituito dalla fase.
+     */
+    template <typename Function>
+    auto measure(const std::string& phase, uint64_t bytes, Function&& function) {
+        pasta::MemoryMonitor& monitor = pasta::MemoryMonitor::instance();
+        monitor.reset_peak();
+        pasta::MemoryMonitorStats before = monitor.get();
+        pasta::Timer timer;
+
+        auto result = function();
+
+        std::size_t time = timer.get();
+        pasta::MemoryMonitorStats after = monitor.get();
+        double throughput = time > 0 ? (bytes / 1e6) / (time / 1e3) : 0.0;
+        std::cout << "RESULT input=" << _input << " n=" << _n << " k=" << _k << " threads=" << _threads
+                  << " run=" << _run << " phase=" << phase << " time_ms=" << time
+                  << " peak_bytes=" << after.peak - before.cur_peak
+                  << " retained_bytes=" << static_cast<int64_t>(after.cur_peak - before.cur_peak)
+                  << " mallocs=" << after.number_malloc - before.number_malloc
+                  << " frees=" << after.number_free - before.number_free
+                  << " mb_per_s=" << throughput << std::endl;
+        return result;
+    }
+};
+
+/**
+ * @brief Esegue le fasi successive alla fattorizzazione con posizioni di tipo Position.
+ * @tparam Position Tipo delle posizioni, sufficiente per la lunghezza del testo.
+ * @param factors Fattorizzazione del testo.
+ * @param threads Numero di thread per build_tree e per la verifica.
+ * @param verify Verifica il suffix array con is_suffix_array() nella fase verify.
+ * @param reporter Destinazione delle misure.
+ * @throw std::runtime_error Se gli insertion target ricalcolati o i suffix array costruiti non coincidono, o se la
+ * verifica fallisce.
+ */
+template <typename Position>
+void bench_construction(Factorization factors, unsigned int threads, bool verify, PhaseReporter& reporter) {
+    using Node = BasicNode<Position>;
+    const uint64_t n = factors.text().size();
+
+    // Riferimento: SA-IS non usa la fattorizzazione, il suo tempo e' la linea di base delle fasi successive.
+    std::vector<Position> baseline = reporter.measure("sais", n, [&]() {
+        return build_suffix_array_sais<Position>(factors.text());
+    });
+
+    BasicTree<Position> tree = reporter.measure("build_tree", n, [&]() {
+        return build_tree<Position>(std::move(factors), threads);
+    });
+
+    // Gli insertion target sono calcolati da build_tree: qui vengono ricalcolati per tutti i nodi, per
+    // misurarne il costo separatamente, e confrontati con quelli memorizzati.
+    reporter.measure("insertion_targets", n, [&]() {
+        std::size_t nodes = 0;
+        std::vector<Node*> stack(1, tree.get_root());
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            for (Node* child : node->get_children()) {
+                std::string_view y = get_strings_difference(child->get_suffix(), node->get_suffix());
+                std::size_t target = getInsertionTarget(node->get_occurrences(), tree.get_icfl(), y);
+                std::size_t overlap = getInsertionOverlap(node->get_occurrences(), tree.get_icfl(), y, target);
+                if (target != child->get_insertion_target() || overlap != child->get_overlap()) {
+                    throw std::runtime_error("Insertion target mismatch at node " + std::string(child->get_suffix()));
+                }
+                stack.push_back(child);
+                ++nodes;
+            }
+        }
+        return nodes;
+    });
+
+    std::vector<Position> sa = reporter.measure("build_suffix_array", n, [&]() {
+        return build_suffix_array(tree.get_root());
+    });
+    if (!std::equal(sa.begin(), sa.end(), baseline.begin(), baseline.end(),
+                    [](uint64_t a, uint64_t b) { return a == b; })) {
+        throw std::runtime_error("build_suffix_array and SA-IS disagree");
+    }
+    baseline = std::vector<Position>();
+
+    if (verify) {
+        bool valid = reporter.measure("verify", n, [&]() {
+            return is_suffix_array<Position>(tree.get_icfl().text(), sa, threads);
+        });
+        if (!valid) {
+            throw std::runtime_error("Suffix array verification failed");
+        }
+    }
+
+    std::size_t lcp_sum = reporter.measure("lcp", n, [&]() {
+        std::vector<Position> lcp = build_lcp_array<Position>(tree.get_icfl().text(), sa, threads);
+        uint64_t sum = 0;
+        for (uint64_t value : lcp) {
+            sum += value;
+        }
+        return sum;
+    });
+    PASTA_DO_NOT_OPTIMIZE(lcp_sum);
+
+    {
+        FMIndex index = reporter.measure("fm_index", n, [&]() {
+            return FMIndex(tree.get_icfl().text(), std::span<const Position>(sa));
+        });
+        // Ogni carattere deve occorrere quanto nel testo, anche con tutti i 256 valori di byte (modello bytes).
+        std::array<uint64_t, 256> frequency = {};
+        for (char c : tree.get_icfl().text()) {
+            ++frequency[static_cast<unsigned char>(c)];
+        }
+        for (std::size_t c = 0; c < frequency.size(); ++c) {
+            const char symbol = static_cast<char>(c);
+            if (index.count(std::string_view(&symbol, 1)) != frequency[c]) {
+                throw std::runtime_error("FM-index counts and text disagree");
+            }
+        }
+
+        // Andata e ritorno su file: l'indice riletto deve dare gli stessi conteggi e localizzare le
+        // sottostringhe del testo nelle loro posizioni.
+        const std::string filename = (std::filesystem::temp_directory_path() / "icfl-bench.fmi").string();
+        index.save(filename);
+        FMIndex loaded(filename);
+        std::filesystem::remove(filename);
+        std::string_view text = tree.get_icfl().text();
+        for (std::size_t c = 0; c < frequency.size(); ++c) {
+            const char symbol = static_cast<char>(c);
+            if (loaded.count(std::string_view(&symbol, 1)) != frequency[c]) {
+                throw std::runtime_error("Reloaded FM-index counts and text disagree");
+            }
+        }
+        for (std::size_t i = 0; i < text.size(); i += text.size() / 16 + 1) {
+            std::string_view pattern = text.substr(i, 8);
+            std::vector<uint64_t> positions = loaded.locate(pattern);
+            if (positions.size() != index.count(pattern) ||
+                std::find(positions.begin(), positions.end(), i) == positions.end()) {
+                throw std::runtime_error("Reloaded FM-index does not locate the text");
+            }
+        }
+    }
+
+    // build_list modifica le g-list dell'albero: e' l'ultima fase.
+    std::size_t size = reporter.measure("build_list", n, [&]() {
+        build_list(tree.get_root());
+        return tree.get_root()->get_g_list().size();
+    });
+    if (size != sa.size() || !std::equal(sa.begin(), sa.end(), tree.get_root()->get_g_list().begin(),
+                                         [](uint64_t a, uint64_t b) { return a == b; })) {
+        throw std::runtime_error("build_list and build_suffix_array disagree");
+    }
+}
+
+/**
+ * @brief Esegue le fasi successive alla fattorizzazione con il tipo di posizione adatto alla lunghezza del testo.
+ * @param factors Fattorizzazione del testo.
+ * @param threads Numero di thread per build_tree e per la verifica.
+ * @param verify Verifica il suffix array con is_suffix_array() nella fase verify.
+ * @param reporter Destinazione delle misure.
+ */
+void bench_factorization(Factorization factors, unsigned int threads, bool verify, PhaseReporter& reporter) {
+    reporter.set_size(factors.text().size(), factors.size());
+
+    std::size_t n = factors.text().size();
+    if (n <= max_position<uint32_t>()) {
+        bench_construction<uint32_t>(std::move(factors), threads, verify, reporter);
+    } else if (n <= max_position<uint40>()) {
+        bench_construction<uint40>(std::move(factors), threads, verify, reporter);
+    } else {
+        bench_construction<uint64_t>(std::move(factors), threads, verify, reporter);
+    }
+}
+
+/**
+ * @brief Esegue tutte le fasi su un file di input.
+ * @param input File di input.
+ * @param factor_file Il file contiene la fattorizzazione invece del testo grezzo.
+ * @param threads Numero di thread per build_tree e per la verifica.
+ * @param verify Verifica il suffix array con is_suffix_array() nella fase verify.
+ * @param run Indice della ripetizione.
+ */
+void bench_input(const std::string& input, bool factor_file, unsigned int threads, bool verify, std::size_t run) {
+    PhaseReporter reporter(input, threads, run);
+    Factorization factors;
+    const uint64_t bytes = std::filesystem::file_size(input);
+    reporter.set_size(bytes, 0);
+
+    if (factor_file) {
+        // Lettura e fattorizzazione coincidono: il file contiene gia' i confini dei fattori.
+        factors = reporter.measure("read", bytes, [&]() { return build_input_ICFL(input); });
+    } else {
+        // La mappatura non legge il file: si accede a ogni pagina per misurare il caricamento.
+        MappedFile file = reporter.measure("read", bytes, [&]() {
+            MappedFile mapped(input);
+            uint64_t checksum = 0;
+            for (std::size_t i = 0; i < mapped.size(); i += 4096) {
+                checksum += static_cast<unsigned char>(mapped.text()[i]);
+            }
+            PASTA_DO_NOT_OPTIMIZE(checksum);
+            return mapped;
+        });
+        factors = reporter.measure("factorize", bytes, [&]() { return factorize_ICFL(std::move(file)); });
+    }
+    bench_factorization(std::move(factors), threads, verify, reporter);
+}
+
+/**
+ * @brief Esegue tutte le fasi su un testo sintetico, a partire dalla fattorizzazione.
+ * @param options Parametri di generazione del testo.
+ * @param threads Numero di thread per build_tree e per la verifica.
+ * @param verify Verifica il suffix array con is_suffix_array() nella fase verify.
+ * @param run Indice della ripetizione.
+ */
+void bench_generated(const GeneratorOptions& options, unsigned int threads, bool verify, std::size_t run) {
+    std::string name = options.model + ":n=" + std::to_string(options.length) + ":sigma=" +
+                       std::to_string(options.sigma);
+    if (options.model == "factors") {
+        name += ":factors=" + std::to_string(options.factors) + ":" + options.distribution;
+    }
+    std::string text = generate_text(options);
+    PhaseReporter reporter(name, threads, run);
+    reporter.set_size(text.size(), 0);
+    Factorization factors = reporter.measure("factorize", text.size(), [&]() {
+        return factorize_ICFL(std::move(text));
+    });
+    bench_factorization(std::move(factors), threads, verify, reporter);
+}
+
+/**
+ * @brief Interpreta un elenco di interi separati da virgole.
+ * @param list Elenco, ad esempio "1000,2000,4000".
+ * @return Gli interi dell'elenco.
+ */
+std::vector<std::size_t> parse_list(const std::string& list) {
+    std::vector<std::size_t> values;
+    std::istringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(std::stoull(value));
+    }
+    return values;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> inputs;
+    bool factor_files = false;
+    unsigned int threads = 1;
+    unsigned int runs = 1;
+    bool verify = false;
+    GeneratorOptions generator;
+    std::string model;
+    std::string lengths = "1000";
+    std::string factor_counts = "10";
+
+    tlx::CmdlineParser cp;
+    cp.set_description("Measures time, heap peak, malloc calls and throughput of every construction phase.");
+    cp.add_flag('f', "factors", factor_files, "The inputs are factor files instead of raw texts");
+    cp.add_uint('t', "threads", threads, "Number of threads used to build the prefix tree (default: 1)");
+    cp.add_flag('V', "verify", verify, "Also run and measure the linear-time verification of the suffix array");
+    cp.add_uint('r', "runs", runs, "Repetitions of every input (default: 1)");
+    cp.add_string('g', "generate", model,
+                  "Sweep over synthetic texts of this model (fibonacci, random, dna, bytes, periodic, factors)");
+    cp.add_string('L', "lengths", lengths, "Comma-separated text lengths of the sweep (default: 1000)");
+    cp.add_string('k', "factor-counts", factor_counts,
+                  "Comma-separated numbers of factors of the sweep, for the factors model (default: 10)");
+    cp.add_uint('s', "sigma", generator.sigma, "Alphabet size of the synthetic texts (default: 4)");
+    cp.add_size_t('p', "period", generator.period, "Period of the periodic model (default: 16)");
+    cp.add_double('m', "mutation", generator.mutation, "Mutation rate of the periodic model (default: 0)");
+    cp.add_string('d', "distribution", generator.distribution,
+                  "Factor length distribution: fixed, uniform or geometric (default: uniform)");
+    cp.add_size_t('S', "seed", generator.seed, "Seed of the synthetic texts (default: 42)");
+    cp.add_opt_param_stringlist("inputs", inputs, "Corpus files");
+
+    if (!cp.process(argc, argv)) {
+        return 1;
+    }
+
+    pasta::MemoryMonitor::instance();
+    try {
+        for (const std::string& input : inputs) {
+            for (std::size_t run = 0; run < runs; ++run) {
+                bench_input(input, factor_files, threads, verify, run);
+            }
+        }
+        if (!model.empty()) {
+            generator.model = model;
+            std::vector<std::size_t> counts = model == "factors" ? parse_list(factor_counts)
+                                                                 : std::vector<std::size_t>{generator.factors};
+            for (std::size_t length : parse_list(lengths)) {
+                for (std::size_t count : counts) {
+                    generator.length = length;
+                    generator.factors = count;
+                    for (std::size_t run = 0; run < runs; ++run) {
+                        bench_generated(generator, threads, verify, run);
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "bench: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
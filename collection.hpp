@@ -0,0 +1,171 @@
+#ifndef ICFL_COLLECTION_HPP
+#define ICFL_COLLECTION_HPP
+
+/**
+ * @file collection.hpp
+ * @brief Collezione di documenti (ad esempio read o documenti brevi) da indicizzare con un suffix array generalizzato.
+ *
+ * I documenti sono memorizzati concatenati in un unico buffer, senza separatori, con gli offset di inizio
+ * di ciascuno; una posizione della concatenazione identifica la coppia (documento, offset). Nel suffix array
+ * generalizzato ogni documento d e' seguito da un separatore $_d, minore di ogni carattere, con
+ * $_0 < $_1 < ...: i suffissi non attraversano mai il confine di un documento e, a parita' di contenuto,
+ * il suffisso del documento con indice minore precede.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "factorization.hpp"
+
+/**
+ * @brief Suffisso di un documento della collezione: una voce del suffix array generalizzato.
+ * @tparam Position Tipo degli indici.
+ */
+template <typename Position>
+struct DocumentSuffix {
+    Position document; ///< Indice del documento.
+    Position offset; ///< Inizio del suffisso all'interno del documento.
+};
+
+/**
+ * @class Collection
+ * @brief Documenti concatenati in un unico buffer, con gli offset di inizio di ciascuno.
+ *
+ * Il documento d occupa l'intervallo [_starts[d], _starts[d + 1]) del testo; l'ultimo elemento di _starts
+ * e' la lunghezza del testo. I documenti vuoti sono ammessi e non hanno suffissi.
+ */
+class Collection {
+
+private:
+    std::string _text; ///< Concatenazione dei documenti.
+    std::vector<uint64_t> _starts; ///< Offset di inizio dei documenti, seguiti dalla lunghezza del testo.
+
+public:
+    /**
+     * @brief Costruttore di default: collezione vuota.
+     */
+    Collection() : _text(), _starts(1, 0) {}
+
+    /**
+     * @brief Costruttore a partire dalla concatenazione dei documenti e dai loro offset di inizio.
+     * @param text Concatenazione dei documenti.
+     * @param starts Offset di inizio di ciascun documento, non decrescenti e a partire da 0.
+     * @throw std::invalid_argument Se gli offset non descrivono una divisione del testo.
+     */
+    Collection(std::string text, std::vector<uint64_t> starts) : _text(std::move(text)), _starts(std::move(starts)) {
+        if ((!_starts.empty() && _starts.front() != 0) || !std::is_sorted(_starts.begin(), _starts.end()) ||
+            (!_starts.empty() && _starts.back() > _text.size())) {
+            throw std::invalid_argument("Invalid document offsets");
+        }
+        _starts.push_back(_text.size());
+    }
+
+    /**
+     * @brief Costruttore a partire dai documenti, che vengono concatenati in un unico buffer.
+     * @param documents Documenti.
+     */
+    explicit Collection(const std::vector<std::string>& documents) {
+        std::size_t length = 0;
+        for (const std::string& document : documents) {
+            length += document.size();
+        }
+        _text.reserve(length);
+        _starts.reserve(documents.size() + 1);
+        for (const std::string& document : documents) {
+            _starts.push_back(_text.size());
+            _text += document;
+        }
+        _starts.push_back(_text.size());
+    }
+
+    /**
+     * @brief Restituisce il numero di documenti.
+     * @return Numero di documenti.
+     */
+    std::size_t size() const {
+        return _starts.size() - 1;
+    }
+
+    /**
+     * @brief Restituisce la concatenazione dei documenti.
+     * @return Vista sul testo.
+     */
+    std::string_view text() const {
+        return _text;
+    }
+
+    /**
+     * @brief Restituisce l'offset di inizio del documento d nella concatenazione.
+     * @param d Indice del documento.
+     * @return Offset di inizio.
+     */
+    uint64_t start(std::size_t d) const {
+        return _starts[d];
+    }
+
+    /**
+     * @brief Restituisce l'offset di fine (escluso) del documento d nella concatenazione.
+     * @param d Indice del documento.
+     * @return Offset di fine.
+     */
+    uint64_t end(std::size_t d) const {
+        return _starts[d + 1];
+    }
+
+    /**
+     * @brief Restituisce il documento d.
+     * @param d Indice del documento.
+     * @return Vista sul documento.
+     */
+    std::string_view document(std::size_t d) const {
+        return std::string_view(_text).substr(_starts[d], _starts[d + 1] - _starts[d]);
+    }
+
+    /**
+     * @brief Restituisce il documento che contiene una posizione della concatenazione.
+     * @param position Posizione, minore della lunghezza del testo.
+     * @return Indice del documento.
+     */
+    std::size_t document_of(uint64_t position) const {
+        return std::upper_bound(_starts.begin(), _starts.end() - 1, position) - _starts.begin() - 1;
+    }
+
+    /**
+     * @brief Converte una posizione della concatenazione nella coppia (documento, offset).
+     * @tparam Position Tipo degli indici.
+     * @param position Posizione, minore della lunghezza del testo.
+     * @return Documento e offset corrispondenti.
+     */
+    template <typename Position>
+    DocumentSuffix<Position> locate(uint64_t position) const {
+        std::size_t d = document_of(position);
+        return {Position(d), Position(position - _starts[d])};
+    }
+};
+
+/**
+ * @brief Calcola la ICFL di ogni documento separatamente e restituisce l'unione dei fattori.
+ *
+ * Il risultato e' una fattorizzazione della concatenazione in cui nessun fattore attraversa il confine di
+ * un documento: i fattori di ogni documento sono esattamente la sua ICFL. Il testo non viene copiato: la
+ * fattorizzazione e' una vista sulla collezione, che deve sopravviverle.
+ *
+ * @param collection Collezione.
+ * @return La fattorizzazione della concatenazione dei documenti.
+ */
+inline Factorization factorize_collection(const Collection& collection) {
+    std::vector<uint64_t> starts;
+    for (std::size_t d = 0; d < collection.size(); ++d) {
+        for (std::size_t start : compute_ICFL(collection.document(d))) {
+            starts.push_back(collection.start(d) + start);
+        }
+    }
+    return Factorization::view(collection.text(), starts);
+}
+
+#endif //ICFL_COLLECTION_HPP
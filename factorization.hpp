@@ -0,0 +1,374 @@
+#ifndef ICFL_FACTORIZATION_HPP
+#define ICFL_FACTORIZATION_HPP
+
+/**
+ * @file factorization.hpp
+ * @brief Rappresentazione compatta di una fattorizzazione e calcolo diretto di ICFL e CFL dal testo.
+ *
+ * Le funzioni di questo file restituiscono i confini dei fattori come offset di inizio all'interno
+ * del testo, senza copiare i singoli fattori. Il testo puo' essere posseduto dalla fattorizzazione oppure
+ * restare in un file mappato in memoria (vedi mapped_file.hpp).
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_file.hpp"
+
+/**
+ * @class Factorization
+ * @brief Fattorizzazione memorizzata come un unico buffer di testo e un vettore di offset.
+ *
+ * Il fattore i-esimo occupa l'intervallo [_starts[i], _starts[i + 1]) del testo; l'ultimo elemento
+ * di _starts e' la lunghezza del testo. L'accesso a un fattore richiede tempo costante e non
+ * effettua copie.
+ *
+ * Il testo e' una stringa posseduta oppure l'intero contenuto di un file mappato in memoria, condiviso
+ * tra le copie della fattorizzazione: in questo caso non viene mai copiato nel processo. Una fattorizzazione
+ * puo' anche essere soltanto una vista su un testo esterno (view() e slice()), che deve sopravviverle.
+ */
+class Factorization {
+
+private:
+    std::string _text; ///< Testo concatenato di tutti i fattori, se posseduto.
+    std::shared_ptr<const MappedFile> _file; ///< File mappato che contiene il testo, nullptr se il testo e' posseduto.
+    std::string_view _view; ///< Testo non posseduto, se _borrowed.
+    bool _borrowed = false; ///< true se il testo e' una vista su un buffer esterno.
+    std::vector<uint64_t> _starts; ///< Offset di inizio dei fattori, seguiti dalla lunghezza del testo.
+
+    /**
+     * @brief Imposta gli offset dei fattori verificando che descrivano una fattorizzazione del testo.
+     * @param starts Offset di inizio di ciascun fattore, in ordine crescente e a partire da 0.
+     * @throw std::invalid_argument Se gli offset non descrivono una fattorizzazione del testo.
+     */
+    template <typename Offset>
+    void set_starts(const std::vector<Offset>& starts) {
+        const std::size_t length = text().size();
+        _starts.reserve(starts.size() + 1);
+        for (Offset start : starts) {
+            if ((_starts.empty() && start != 0) || (!_starts.empty() && start <= _starts.back())) {
+                throw std::invalid_argument("Invalid factor offsets");
+            }
+            _starts.push_back(start);
+        }
+        if (!_starts.empty() && _starts.back() >= length) {
+            throw std::invalid_argument("Invalid factor offsets");
+        }
+        _starts.push_back(length);
+    }
+
+public:
+    /**
+     * @brief Costruttore di default: fattorizzazione vuota.
+     */
+    Factorization() : _text(), _starts(1, 0) {}
+
+    /**
+     * @brief Costruttore a partire dal testo e dagli offset di inizio dei fattori.
+     * @param text Testo fattorizzato.
+     * @param starts Offset di inizio di ciascun fattore, in ordine crescente e a partire da 0.
+     * @throw std::invalid_argument Se gli offset non descrivono una fattorizzazione del testo.
+     */
+    template <typename Offset>
+    Factorization(std::string text, const std::vector<Offset>& starts) : _text(std::move(text)) {
+        set_starts(starts);
+    }
+
+    /**
+     * @brief Costruttore a partire da un file mappato, il cui intero contenuto e' il testo fattorizzato.
+     * @param file File mappato; la mappatura resta valida finche' esiste una copia della fattorizzazione.
+     * @param starts Offset di inizio di ciascun fattore, in ordine crescente e a partire da 0.
+     * @throw std::invalid_argument Se gli offset non descrivono una fattorizzazione del testo.
+     */
+    template <typename Offset>
+    Factorization(MappedFile file, const std::vector<Offset>& starts)
+            : _text(), _file(std::make_shared<const MappedFile>(std::move(file))) {
+        set_starts(starts);
+    }
+
+    /**
+     * @brief Costruttore a partire da una lista di fattori, che vengono concatenati in un unico buffer.
+     * @param factors Lista dei fattori.
+     */
+    explicit Factorization(const std::list<std::string>& factors) {
+        std::size_t length = 0;
+        for (const std::string& factor : factors) {
+            length += factor.size();
+        }
+        _text.reserve(length);
+        _starts.reserve(factors.size() + 1);
+        for (const std::string& factor : factors) {
+            _starts.push_back(_text.size());
+            _text += factor;
+        }
+        _starts.push_back(_text.size());
+    }
+
+    /**
+     * @brief Costruisce una fattorizzazione che mantiene soltanto una vista sul testo, senza copiarlo.
+     * @param text Testo fattorizzato; deve restare valido finche' esiste una copia della fattorizzazione.
+     * @param starts Offset di inizio di ciascun fattore, in ordine crescente e a partire da 0.
+     * @return La fattorizzazione.
+     * @throw std::invalid_argument Se gli offset non descrivono una fattorizzazione del testo.
+     */
+    template <typename Offset>
+    static Factorization view(std::string_view text, const std::vector<Offset>& starts) {
+        Factorization factorization;
+        factorization._view = text;
+        factorization._borrowed = true;
+        factorization._starts.clear();
+        factorization.set_starts(starts);
+        return factorization;
+    }
+
+    /**
+     * @brief Restituisce la fattorizzazione formata dai fattori [first, last), come vista sul loro testo.
+     *
+     * Gli offset sono relativi all'inizio del fattore first. Il testo non viene copiato: un file mappato resta
+     * condiviso, mentre un testo posseduto o una vista devono sopravvivere al risultato.
+     *
+     * @param first Indice del primo fattore.
+     * @param last Indice successivo all'ultimo fattore, al piu' size().
+     * @return La fattorizzazione dei fattori [first, last).
+     */
+    Factorization slice(std::size_t first, std::size_t last) const {
+        Factorization factorization;
+        factorization._file = _file;
+        factorization._view = text().substr(_starts[first], _starts[last] - _starts[first]);
+        factorization._borrowed = true;
+        factorization._starts.assign(_starts.begin() + first, _starts.begin() + last + 1);
+        for (uint64_t& start : factorization._starts) {
+            start -= _starts[first];
+        }
+        return factorization;
+    }
+
+    /**
+     * @brief Restituisce il numero di fattori.
+     * @return Numero di fattori.
+     */
+    std::size_t size() const {
+        return _starts.size() - 1;
+    }
+
+    /**
+     * @brief Restituisce il testo concatenato.
+     * @return Vista sul testo.
+     */
+    std::string_view text() const {
+        if (_borrowed) {
+            return _view;
+        }
+        return _file ? _file->text() : std::string_view(_text);
+    }
+
+    /**
+     * @brief Restituisce l'offset di inizio del fattore i-esimo.
+     * @param i Indice del fattore.
+     * @return Posizione nel testo del primo carattere del fattore.
+     */
+    uint64_t start(std::size_t i) const {
+        return _starts[i];
+    }
+
+    /**
+     * @brief Restituisce l'offset di fine (escluso) del fattore i-esimo.
+     * @param i Indice del fattore.
+     * @return Posizione nel testo successiva all'ultimo carattere del fattore.
+     */
+    uint64_t end(std::size_t i) const {
+        return _starts[i + 1];
+    }
+
+    /**
+     * @brief Restituisce la lunghezza del fattore i-esimo.
+     * @param i Indice del fattore.
+     * @return Lunghezza del fattore.
+     */
+    uint64_t length(std::size_t i) const {
+        return _starts[i + 1] - _starts[i];
+    }
+
+    /**
+     * @brief Restituisce il fattore i-esimo.
+     * @param i Indice del fattore.
+     * @return Vista sul fattore all'interno del testo.
+     */
+    std::string_view factor(std::size_t i) const {
+        return text().substr(_starts[i], _starts[i + 1] - _starts[i]);
+    }
+
+    /**
+     * @brief Restituisce gli offset di inizio dei fattori, seguiti dalla lunghezza del testo.
+     * @return Riferimento costante al vettore degli offset.
+     */
+    const std::vector<uint64_t>& starts() const {
+        return _starts;
+    }
+};
+
+/**
+ * @brief Calcola la fattorizzazione inversa di Lyndon canonica ICFL(w) in tempo lineare.
+ *
+ * Implementa l'algoritmo ricorsivo di Bonizzoni et al. (Find-prefix, Find-bre e fusione del primo
+ * fattore) in forma iterativa. A ogni passo la scansione di Find-prefix riparte dal bordo r scelto
+ * da Find-bre: il bordo e' un prefisso della parola appena analizzata, quindi lo stato della scansione
+ * e la funzione di fallimento (KMP) calcolati sui suoi caratteri restano validi e non vengono
+ * ricalcolati. Ogni carattere del testo viene cosi' letto un numero costante di volte.
+ *
+ * I caratteri sono confrontati come unsigned char, coerentemente con l'ordine di std::string.
+ *
+ * @param text Testo da fattorizzare.
+ * @return Offset di inizio di ciascun fattore m_1, ..., m_k (vuoto se il testo e' vuoto).
+ */
+std::vector<std::size_t> compute_ICFL(std::string_view text) {
+    const std::size_t n = text.size();
+    std::vector<std::size_t> starts;
+    if (n == 0) {
+        return starts;
+    }
+
+    auto at = [&text](std::size_t i) { return static_cast<unsigned char>(text[i]); };
+
+    // state[j]: indice i di Find-prefix prima di leggere il carattere j (relativo a pos).
+    // border[t]: lunghezza del bordo massimo di w[pos, pos + t] (funzione di fallimento).
+    std::vector<std::size_t> state(2, 0);
+    std::vector<std::size_t> border(1, 0);
+    // Per ogni passo: lunghezza del prefisso x' prodotto da Find-bre e lunghezza del bordo r.
+    std::vector<std::pair<std::size_t, std::size_t>> chain;
+
+    std::size_t pos = 0;
+    std::size_t kept = 0; // prefisso (relativo a pos) gia' analizzato al passo precedente
+
+    while (true) {
+        const std::size_t rest = n - pos;
+
+        // Find-prefix: si riprende dallo stato memorizzato dopo il bordo.
+        std::size_t j = kept > 1 ? kept : 1;
+        std::size_t i = state[j];
+        while (j < rest && at(pos + j) <= at(pos + i)) {
+            i = at(pos + j) < at(pos + i) ? 0 : i + 1;
+            ++j;
+            if (j >= state.size()) {
+                state.resize(2 * j);
+            }
+            state[j] = i;
+        }
+        if (j == rest) {
+            break; // il suffisso rimanente e' una parola inversa di Lyndon
+        }
+
+        // Find-bre: x = w[pos, pos + j], u = w[pos, pos + j), b = w[pos + j].
+        if (j > border.size()) {
+            border.resize(2 * j);
+        }
+        for (std::size_t t = kept > 1 ? kept : 1; t < j; ++t) {
+            std::size_t k = border[t - 1];
+            while (k > 0 && at(pos + t) != at(pos + k)) {
+                k = border[k - 1];
+            }
+            if (at(pos + t) == at(pos + k)) {
+                ++k;
+            }
+            border[t] = k;
+        }
+        const unsigned char b = at(pos + j);
+        std::size_t last = border[j - 1];
+        while (last > 0 && !(at(pos + last) < b)) {
+            last = border[last - 1];
+        }
+
+        chain.emplace_back(j - last, last);
+        pos += j - last;
+        kept = last;
+    }
+
+    // Ricostruzione all'indietro: il prefisso x' diventa un fattore a se' solo se il primo fattore
+    // della parte destra e' piu' lungo del bordo, altrimenti viene fuso con esso.
+    std::vector<std::size_t> lengths;
+    lengths.push_back(n - pos);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if (lengths.back() > it->second) {
+            lengths.push_back(it->first);
+        } else {
+            lengths.back() += it->first;
+        }
+    }
+
+    starts.reserve(lengths.size());
+    std::size_t offset = 0;
+    for (auto it = lengths.rbegin(); it != lengths.rend(); ++it) {
+        starts.push_back(offset);
+        offset += *it;
+    }
+    return starts;
+}
+
+/**
+ * @brief Calcola la fattorizzazione canonica di Lyndon CFL(w) (Chen-Fox-Lyndon) in tempo lineare.
+ *
+ * Variante canonica basata sull'algoritmo di Duval. I fattori sono parole di Lyndon non crescenti;
+ * la costruzione del prefix-tree di func.hpp richiede invece la ICFL.
+ *
+ * @param text Testo da fattorizzare.
+ * @return Offset di inizio di ciascun fattore (vuoto se il testo e' vuoto).
+ */
+std::vector<std::size_t> compute_CFL(std::string_view text) {
+    const std::size_t n = text.size();
+    std::vector<std::size_t> starts;
+
+    auto at = [&text](std::size_t i) { return static_cast<unsigned char>(text[i]); };
+
+    std::size_t pos = 0;
+    while (pos < n) {
+        std::size_t i = pos;
+        std::size_t j = pos + 1;
+        while (j < n && at(i) <= at(j)) {
+            i = at(i) < at(j) ? pos : i + 1;
+            ++j;
+        }
+        while (pos <= i) {
+            starts.push_back(pos);
+            pos += j - i;
+        }
+    }
+    return starts;
+}
+
+/**
+ * @brief Calcola la ICFL del testo e la restituisce in forma compatta.
+ * @param text Testo da fattorizzare; viene spostato all'interno della fattorizzazione.
+ * @return La fattorizzazione ICFL del testo.
+ */
+Factorization factorize_ICFL(std::string text) {
+    std::vector<std::size_t> starts = compute_ICFL(text);
+    return Factorization(std::move(text), starts);
+}
+
+/**
+ * @brief Calcola la ICFL del contenuto di un file mappato, senza copiarlo.
+ * @param file File mappato; viene spostato all'interno della fattorizzazione.
+ * @return La fattorizzazione ICFL del contenuto del file.
+ */
+Factorization factorize_ICFL(MappedFile file) {
+    std::vector<std::size_t> starts = compute_ICFL(file.text());
+    return Factorization(std::move(file), starts);
+}
+
+/**
+ * @brief Calcola la CFL del testo e la restituisce in forma compatta.
+ * @param text Testo da fattorizzare; viene spostato all'interno della fattorizzazione.
+ * @return La fattorizzazione CFL del testo.
+ */
+Factorization factorize_CFL(std::string text) {
+    std::vector<std::size_t> starts = compute_CFL(text);
+    return Factorization(std::move(text), starts);
+}
+
+#endif //ICFL_FACTORIZATION_HPP
@@ -0,0 +1,100 @@
+#ifndef ICFL_FINGERPRINT_HPP
+#define ICFL_FINGERPRINT_HPP
+
+/**
+ * @file fingerprint.hpp
+ * @brief Fingerprint di Karp-Rabin per usare i suffissi dei fattori come chiavi di tabelle hash.
+ *
+ * Il fingerprint di s e' sum_j s[j] * B^(|s| - 1 - j) modulo il primo di Mersenne 2^61 - 1. Estendere
+ * un suffisso di un carattere verso sinistra costa O(1): fp(c s) = c * B^|s| + fp(s).
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+constexpr uint64_t FINGERPRINT_MODULUS = (uint64_t(1) << 61) - 1; ///< Primo di Mersenne 2^61 - 1.
+constexpr uint64_t FINGERPRINT_BASE = 0x1d4f9a2b6c3e5a7ULL % FINGERPRINT_MODULUS; ///< Base del polinomio.
+
+/**
+ * @brief Prodotto modulo 2^61 - 1.
+ * @param a Primo fattore, minore del modulo.
+ * @param b Secondo fattore, minore del modulo.
+ * @return (a * b) mod (2^61 - 1).
+ */
+inline uint64_t fingerprint_mul(uint64_t a, uint64_t b) {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    uint64_t result = static_cast<uint64_t>(product & FINGERPRINT_MODULUS) + static_cast<uint64_t>(product >> 61);
+    return result >= FINGERPRINT_MODULUS ? result - FINGERPRINT_MODULUS : result;
+}
+
+/**
+ * @brief Somma modulo 2^61 - 1.
+ * @param a Primo addendo, minore del modulo.
+ * @param b Secondo addendo, minore del modulo.
+ * @return (a + b) mod (2^61 - 1).
+ */
+inline uint64_t fingerprint_add(uint64_t a, uint64_t b) {
+    uint64_t result = a + b;
+    return result >= FINGERPRINT_MODULUS ? result - FINGERPRINT_MODULUS : result;
+}
+
+/**
+ * @brief Fingerprint del suffisso c s, dato quello di s.
+ * @param c Carattere aggiunto a sinistra.
+ * @param fingerprint Fingerprint di s.
+ * @param power B^|s| mod (2^61 - 1).
+ * @return Fingerprint di c s.
+ */
+inline uint64_t fingerprint_prepend(unsigned char c, uint64_t fingerprint, uint64_t power) {
+    return fingerprint_add(fingerprint_mul(c, power), fingerprint);
+}
+
+/**
+ * @brief Fingerprint della sequenza s v, dato quello di s.
+ * @param fingerprint Fingerprint di s.
+ * @param value Valore aggiunto a destra (ridotto modulo 2^61 - 1).
+ * @return Fingerprint di s v.
+ */
+inline uint64_t fingerprint_append(uint64_t fingerprint, uint64_t value) {
+    return fingerprint_add(fingerprint_mul(fingerprint, FINGERPRINT_BASE), value % FINGERPRINT_MODULUS);
+}
+
+/**
+ * @brief Fingerprint di un intero testo, usato anche come checksum.
+ * @param text Testo.
+ * @return Fingerprint di text.
+ */
+inline uint64_t text_fingerprint(std::string_view text) {
+    uint64_t fingerprint = 0;
+    for (char c : text) {
+        fingerprint = fingerprint_append(fingerprint, static_cast<unsigned char>(c));
+    }
+    return fingerprint;
+}
+
+/**
+ * @brief Chiave di una tabella hash: vista su un suffisso del testo condiviso e il suo fingerprint.
+ *
+ * L'hash e' il fingerprint stesso; l'uguaglianza confronta i fingerprint e, solo se coincidono,
+ * verifica le due viste sul testo, quindi una collisione non produce mai risultati errati.
+ */
+struct SuffixKey {
+    std::string_view suffix; ///< Vista sul suffisso, nel testo posseduto dall'albero.
+    uint64_t fingerprint; ///< Fingerprint di Karp-Rabin del suffisso.
+
+    bool operator==(const SuffixKey& other) const {
+        return fingerprint == other.fingerprint && suffix == other.suffix;
+    }
+};
+
+/**
+ * @brief Funzione hash per SuffixKey: restituisce il fingerprint, gia' calcolato.
+ */
+struct SuffixKeyHash {
+    std::size_t operator()(const SuffixKey& key) const {
+        return static_cast<std::size_t>(key.fingerprint);
+    }
+};
+
+#endif //ICFL_FINGERPRINT_HPP
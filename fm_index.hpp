@@ -0,0 +1,541 @@
+#ifndef ICFL_FM_INDEX_HPP
+#define ICFL_FM_INDEX_HPP
+
+/**
+ * @file fm_index.hpp
+ * @brief Trasformata di Burrows-Wheeler e FM-index costruiti dal suffix array, con salvataggio su file.
+ *
+ * La BWT e' quella del testo seguito da un terminatore $ minore di ogni carattere: ha n + 1 simboli e il
+ * terminatore sta nella riga primary, quella del suffisso che inizia in 0. L'FM-index memorizza la BWT in
+ * una wavelet matrix sull'alfabeto effettivo del testo (ceil(log2(sigma + 1)) livelli, ognuno un
+ * pasta::BitVector con pasta::FlatRankSelect), l'array C dei conteggi cumulativi e un campione del suffix
+ * array, una posizione ogni sample_rate caratteri del testo, per l'operazione locate. Il terminatore ha
+ * codice 0 e i caratteri i codici da 1 a sigma: con tutti i 256 valori di byte servono 257 simboli, per cui
+ * i simboli sono a 16 bit.
+ *
+ * Il file e' formato da un'intestazione little-endian, come quella di suffix_array_io.hpp:
+ *
+ * | offset | byte | campo                                                        |
+ * |--------|------|--------------------------------------------------------------|
+ * | 0      | 8    | magic "ICFLFMI\0"                                            |
+ * | 8      | 4    | versione del formato (2)                                     |
+ * | 12     | 4    | numero di livelli della wavelet matrix                       |
+ * | 16     | 8    | lunghezza del testo n                                        |
+ * | 24     | 8    | checksum del testo (text_fingerprint())                      |
+ * | 32     | 8    | riga primary                                                 |
+ * | 40     | 8    | sample_rate                                                  |
+ * | 48     | 8    | numero di campioni del suffix array                          |
+ * | 56     | 8    | dimensione dell'alfabeto effettivo sigma                     |
+ *
+ * seguita da 256 valori a 2 byte con il codice di ogni carattere (0 se assente), da 258 valori a 8 byte
+ * dell'array C, da ogni livello (numero di zeri, poi le (n + 1) / 64 + 1 parole a 64 bit del BitVector),
+ * dalle righe campionate (le parole del BitVector che le marca) e dai campioni, a 8 byte ciascuno. Il
+ * supporto rank/select viene ricostruito alla lettura. Vengono letti soltanto i file della versione
+ * FM_INDEX_VERSION.
+ */
+
+#include <pasta/bit_vector/bit_vector.hpp>
+#include <pasta/bit_vector/support/flat_rank_select.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "fingerprint.hpp"
+#include "mapped_file.hpp"
+#include "suffix_array_io.hpp"
+
+constexpr std::array<char, 8> FM_INDEX_MAGIC = {'I', 'C', 'F', 'L', 'F', 'M', 'I', '\0'}; ///< Magic del formato.
+constexpr uint32_t FM_INDEX_VERSION = 2; ///< Versione del formato.
+constexpr std::size_t FM_INDEX_HEADER_SIZE = 64; ///< Dimensione dell'intestazione in byte.
+
+/**
+ * @brief Calcola la BWT di text$ dal suffix array di text.
+ *
+ * La riga 0 corrisponde al suffisso vuoto $, le righe successive ai suffissi in ordine di suffix array:
+ * bwt[0] = text[n - 1] e bwt[i + 1] = text[sa[i] - 1], oppure il terminatore se sa[i] = 0.
+ *
+ * @tparam Position Tipo delle posizioni del suffix array.
+ * @param text Testo.
+ * @param sa Suffix array del testo.
+ * @param primary Riceve la riga del terminatore.
+ * @return La BWT, lunga n + 1; nella riga primary c'e' un carattere nullo al posto del terminatore.
+ */
+template <typename Position>
+std::string build_bwt(std::string_view text, std::span<const Position> sa, uint64_t& primary) {
+    const std::size_t n = text.size();
+    std::string bwt(n + 1, '\0');
+    primary = 0;
+    if (n == 0) {
+        return bwt;
+    }
+    bwt[0] = text[n - 1];
+    for (std::size_t i = 0; i < n; ++i) {
+        uint64_t position = sa[i];
+        if (position == 0) {
+            primary = i + 1;
+        } else {
+            bwt[i + 1] = text[position - 1];
+        }
+    }
+    return bwt;
+}
+
+/**
+ * @class WaveletMatrix
+ * @brief Sequenza di simboli interi con accesso e rank in O(log sigma), su BitVector con supporto rank/select.
+ *
+ * Il livello l contiene il bit l-esimo (dal piu' significativo) del simbolo di ogni posizione, dopo che le
+ * posizioni sono state ordinate stabilmente sui bit dei livelli precedenti, con gli zeri prima degli uni.
+ */
+class WaveletMatrix {
+
+public:
+    using rank_select_type = pasta::FlatRankSelect<>; ///< Supporto rank/select dei livelli.
+
+private:
+    uint64_t _size; ///< Lunghezza della sequenza.
+    std::vector<std::unique_ptr<pasta::BitVector>> _levels; ///< Bit di ogni livello.
+    std::vector<rank_select_type> _rank_select; ///< Supporto rank/select di ogni livello.
+    std::vector<uint64_t> _zeros; ///< Numero di zeri di ogni livello.
+
+    /**
+     * @brief Costruisce il supporto rank/select e conta gli zeri di ogni livello.
+     */
+    void build_support() {
+        _rank_select.clear();
+        _zeros.clear();
+        for (const std::unique_ptr<pasta::BitVector>& level : _levels) {
+            _rank_select.emplace_back(*level);
+            _zeros.push_back(_rank_select.back().rank0(_size));
+        }
+    }
+
+public:
+    /**
+     * @brief Costruisce una sequenza vuota.
+     */
+    WaveletMatrix() : _size(0) {}
+
+    /**
+     * @brief Costruisce la wavelet matrix di una sequenza.
+     * @param symbols Simboli della sequenza.
+     * @param levels Bit per simbolo, al piu' 16: ogni simbolo deve essere minore di 2^levels.
+     */
+    WaveletMatrix(std::vector<uint16_t> symbols, unsigned int levels) : _size(symbols.size()) {
+        std::vector<uint16_t> next(symbols.size());
+        for (unsigned int l = 0; l < levels; ++l) {
+            const unsigned int shift = levels - 1 - l;
+            auto bits = std::make_unique<pasta::BitVector>(_size, false);
+            std::size_t zeros = 0;
+            for (std::size_t i = 0; i < _size; ++i) {
+                if ((symbols[i] >> shift) & 1) {
+                    (*bits)[i] = true;
+                } else {
+                    ++zeros;
+                }
+            }
+            // Ordinamento stabile sul bit corrente per il livello successivo.
+            std::size_t zero = 0, one = zeros;
+            for (std::size_t i = 0; i < _size; ++i) {
+                next[((symbols[i] >> shift) & 1) ? one++ : zero++] = symbols[i];
+            }
+            symbols.swap(next);
+            _levels.push_back(std::move(bits));
+        }
+        build_support();
+    }
+
+    /**
+     * @brief Ricostruisce una wavelet matrix dai livelli salvati.
+     * @param size Lunghezza della sequenza.
+     * @param levels BitVector dei livelli, ognuno lungo size bit.
+     */
+    WaveletMatrix(uint64_t size, std::vector<std::unique_ptr<pasta::BitVector>> levels)
+            : _size(size), _levels(std::move(levels)) {
+        build_support();
+    }
+
+    WaveletMatrix(const WaveletMatrix&) = delete;
+    WaveletMatrix& operator=(const WaveletMatrix&) = delete;
+    WaveletMatrix(WaveletMatrix&&) = default;
+    WaveletMatrix& operator=(WaveletMatrix&&) = default;
+
+    /**
+     * @brief Restituisce la lunghezza della sequenza.
+     * @return Numero di simboli.
+     */
+    uint64_t size() const {
+        return _size;
+    }
+
+    /**
+     * @brief Restituisce i livelli, per il salvataggio.
+     * @return BitVector dei livelli, dal bit piu' significativo.
+     */
+    const std::vector<std::unique_ptr<pasta::BitVector>>& levels() const {
+        return _levels;
+    }
+
+    /**
+     * @brief Restituisce il numero di zeri di un livello.
+     * @param level Livello.
+     * @return Numero di zeri.
+     */
+    uint64_t zeros(std::size_t level) const {
+        return _zeros[level];
+    }
+
+    /**
+     * @brief Restituisce il simbolo in posizione i.
+     * @param i Posizione, minore di size().
+     * @return Il simbolo.
+     */
+    uint16_t access(uint64_t i) const {
+        uint16_t symbol = 0;
+        for (std::size_t l = 0; l < _levels.size(); ++l) {
+            if ((*_levels[l])[i]) {
+                symbol = (symbol << 1) | 1;
+                i = _zeros[l] + _rank_select[l].rank1(i);
+            } else {
+                symbol <<= 1;
+                i = _rank_select[l].rank0(i);
+            }
+        }
+        return symbol;
+    }
+
+    /**
+     * @brief Conta le occorrenze di un simbolo nel prefisso [0, i).
+     * @param symbol Simbolo.
+     * @param i Lunghezza del prefisso, al piu' size().
+     * @return Numero di occorrenze.
+     */
+    uint64_t rank(uint16_t symbol, uint64_t i) const {
+        uint64_t start = 0;
+        for (std::size_t l = 0; l < _levels.size(); ++l) {
+            if ((symbol >> (_levels.size() - 1 - l)) & 1) {
+                i = _zeros[l] + _rank_select[l].rank1(i);
+                start = _zeros[l] + _rank_select[l].rank1(start);
+            } else {
+                i = _rank_select[l].rank0(i);
+                start = _rank_select[l].rank0(start);
+            }
+        }
+        return i - start;
+    }
+};
+
+/**
+ * @class FMIndex
+ * @brief FM-index di un testo: conteggio e localizzazione delle occorrenze di un pattern tramite backward search.
+ */
+class FMIndex {
+
+public:
+    using rank_select_type = pasta::FlatRankSelect<>; ///< Supporto rank/select delle righe campionate.
+
+private:
+    uint64_t _n; ///< Lunghezza del testo.
+    uint64_t _checksum; ///< Fingerprint del testo.
+    uint64_t _primary; ///< Riga del terminatore nella BWT.
+    uint64_t _sample_rate; ///< Distanza tra le posizioni campionate del suffix array.
+    std::array<uint16_t, 256> _code; ///< Codice di ogni carattere (1..sigma), 0 se assente; 0 e' il terminatore.
+    uint64_t _sigma; ///< Numero di caratteri distinti del testo.
+    std::array<uint64_t, 258> _counts; ///< _counts[c]: simboli della BWT con codice minore di c.
+    WaveletMatrix _bwt; ///< BWT codificata.
+    std::unique_ptr<pasta::BitVector> _sampled; ///< Righe il cui suffisso e' campionato.
+    rank_select_type _sampled_rank; ///< Supporto rank su _sampled.
+    std::vector<uint64_t> _samples; ///< Posizioni delle righe campionate, in ordine di riga.
+
+    /**
+     * @brief Numero di livelli della wavelet matrix per l'alfabeto corrente (terminatore incluso).
+     * @return ceil(log2(sigma + 1)), almeno 1.
+     */
+    unsigned int levels() const {
+        unsigned int levels = 1;
+        while ((uint64_t(1) << levels) < _sigma + 1) {
+            ++levels;
+        }
+        return levels;
+    }
+
+    /**
+     * @brief Passo LF: la riga del suffisso che inizia un carattere prima di quello della riga i.
+     * @param i Riga, diversa da primary.
+     * @return La riga precedente nel testo.
+     */
+    uint64_t lf(uint64_t i) const {
+        uint16_t symbol = _bwt.access(i);
+        return _counts[symbol] + _bwt.rank(symbol, i);
+    }
+
+    /**
+     * @brief Costruttore vuoto, usato dalla lettura da file.
+     */
+    FMIndex() : _n(0), _checksum(0), _primary(0), _sample_rate(1), _code(), _sigma(0), _counts() {}
+
+public:
+    /**
+     * @brief Costruisce l'FM-index di un testo a partire dal suo suffix array.
+     *
+     * La BWT viene calcolata con build_bwt(), ricodificata sull'alfabeto effettivo e memorizzata nella
+     * wavelet matrix; il suffix array viene campionato nelle righe dei suffissi che iniziano in una posizione
+     * multipla di sample_rate.
+     *
+     * @tparam Position Tipo delle posizioni del suffix array.
+     * @param text Testo.
+     * @param sa Suffix array del testo.
+     * @param sample_rate Distanza tra le posizioni campionate: locate esegue al piu' sample_rate - 1 passi LF
+     *        per occorrenza.
+     * @throw std::invalid_argument Se sample_rate e' nullo o sa non ha la lunghezza del testo.
+     */
+    template <typename Position>
+    FMIndex(std::string_view text, std::span<const Position> sa, uint64_t sample_rate = 32)
+            : _n(text.size()), _checksum(text_fingerprint(text)), _primary(0), _sample_rate(sample_rate),
+              _code(), _sigma(0), _counts() {
+        if (sample_rate == 0) {
+            throw std::invalid_argument("The sample rate must be positive");
+        }
+        if (sa.size() != text.size()) {
+            throw std::invalid_argument("Suffix array and text lengths differ");
+        }
+        std::array<bool, 256> present = {};
+        for (char c : text) {
+            present[static_cast<unsigned char>(c)] = true;
+        }
+        for (std::size_t c = 0; c < 256; ++c) {
+            if (present[c]) {
+                _code[c] = static_cast<uint16_t>(++_sigma);
+            }
+        }
+
+        std::string bwt = build_bwt<Position>(text, sa, _primary);
+        std::vector<uint16_t> symbols(_n + 1);
+        for (std::size_t i = 0; i <= _n; ++i) {
+            symbols[i] = i == _primary ? 0 : _code[static_cast<unsigned char>(bwt[i])];
+            ++_counts[symbols[i] + 1];
+        }
+        bwt = std::string();
+        for (std::size_t c = 1; c < _counts.size(); ++c) {
+            _counts[c] += _counts[c - 1];
+        }
+        _bwt = WaveletMatrix(std::move(symbols), levels());
+
+        // La riga 0 (suffisso vuoto, posizione n) non viene mai raggiunta da locate.
+        _sampled = std::make_unique<pasta::BitVector>(_n + 1, false);
+        for (std::size_t i = 0; i < _n; ++i) {
+            uint64_t position = sa[i];
+            if (position % _sample_rate == 0) {
+                (*_sampled)[i + 1] = true;
+                _samples.push_back(position);
+            }
+        }
+        _sampled_rank = rank_select_type(*_sampled);
+    }
+
+    /**
+     * @brief Legge un FM-index salvato con save().
+     * @param filename Percorso del file.
+     * @throw std::runtime_error Se il file non puo' essere letto o non e' un FM-index valido.
+     */
+    explicit FMIndex(const std::string& filename) : FMIndex() {
+        MappedFile file(filename);
+        std::span<const std::byte> bytes = file.bytes();
+        if (bytes.size() < FM_INDEX_HEADER_SIZE ||
+            std::memcmp(bytes.data(), FM_INDEX_MAGIC.data(), FM_INDEX_MAGIC.size()) != 0) {
+            throw std::runtime_error("Not an FM-index file: " + filename);
+        }
+        const uint64_t version = load_little_endian(bytes.data() + 8, 4);
+        if (version != FM_INDEX_VERSION) {
+            throw std::runtime_error("Unsupported FM-index version in: " + filename);
+        }
+        const uint64_t level_count = load_little_endian(bytes.data() + 12, 4);
+        _n = load_little_endian(bytes.data() + 16, 8);
+        _checksum = load_little_endian(bytes.data() + 24, 8);
+        _primary = load_little_endian(bytes.data() + 32, 8);
+        _sample_rate = load_little_endian(bytes.data() + 40, 8);
+        const uint64_t sample_count = load_little_endian(bytes.data() + 48, 8);
+        _sigma = load_little_endian(bytes.data() + 56, 8);
+
+        const uint64_t words = (_n + 1) / 64 + 1;
+        const uint64_t expected = FM_INDEX_HEADER_SIZE + 256 * 2 + _counts.size() * 8 +
+                                  level_count * (8 + words * 8) + words * 8 + sample_count * 8;
+        if (_sigma > 256 || _sample_rate == 0 || level_count != levels() || bytes.size() != expected) {
+            throw std::runtime_error("Corrupted FM-index file: " + filename);
+        }
+
+        const std::byte* cursor = bytes.data() + FM_INDEX_HEADER_SIZE;
+        for (std::size_t c = 0; c < 256; ++c) {
+            _code[c] = static_cast<uint16_t>(load_little_endian(cursor, 2));
+            cursor += 2;
+        }
+        for (uint64_t& count : _counts) {
+            count = load_little_endian(cursor, 8);
+            cursor += 8;
+        }
+        auto read_bits = [&]() {
+            auto bits = std::make_unique<pasta::BitVector>(_n + 1);
+            for (uint64_t& word : bits->data()) {
+                word = load_little_endian(cursor, 8);
+                cursor += 8;
+            }
+            return bits;
+        };
+        std::vector<std::unique_ptr<pasta::BitVector>> levels;
+        for (uint64_t l = 0; l < level_count; ++l) {
+            cursor += 8; // numero di zeri, ricalcolato dal supporto rank
+            levels.push_back(read_bits());
+        }
+        _bwt = WaveletMatrix(_n + 1, std::move(levels));
+        _sampled = read_bits();
+        _sampled_rank = rank_select_type(*_sampled);
+        _samples.resize(sample_count);
+        for (uint64_t& sample : _samples) {
+            sample = load_little_endian(cursor, 8);
+            cursor += 8;
+        }
+    }
+
+    FMIndex(const FMIndex&) = delete;
+    FMIndex& operator=(const FMIndex&) = delete;
+    FMIndex(FMIndex&&) = default;
+    FMIndex& operator=(FMIndex&&) = default;
+
+    /**
+     * @brief Salva l'FM-index nel formato descritto in fm_index.hpp.
+     * @param filename Percorso del file da scrivere.
+     * @throw std::runtime_error Se il file non puo' essere scritto.
+     */
+    void save(const std::string& filename) const {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        char header[FM_INDEX_HEADER_SIZE] = {};
+        std::copy(FM_INDEX_MAGIC.begin(), FM_INDEX_MAGIC.end(), header);
+        store_little_endian(header + 8, FM_INDEX_VERSION, 4);
+        store_little_endian(header + 12, _bwt.levels().size(), 4);
+        store_little_endian(header + 16, _n, 8);
+        store_little_endian(header + 24, _checksum, 8);
+        store_little_endian(header + 32, _primary, 8);
+        store_little_endian(header + 40, _sample_rate, 8);
+        store_little_endian(header + 48, _samples.size(), 8);
+        store_little_endian(header + 56, _sigma, 8);
+        file.write(header, FM_INDEX_HEADER_SIZE);
+
+        char word[8];
+        for (uint16_t code : _code) {
+            store_little_endian(word, code, 2);
+            file.write(word, 2);
+        }
+        auto write_word = [&](uint64_t value) {
+            store_little_endian(word, value, 8);
+            file.write(word, 8);
+        };
+        for (uint64_t count : _counts) {
+            write_word(count);
+        }
+        for (std::size_t l = 0; l < _bwt.levels().size(); ++l) {
+            write_word(_bwt.zeros(l));
+            for (uint64_t bits : _bwt.levels()[l]->data()) {
+                write_word(bits);
+            }
+        }
+        for (uint64_t bits : _sampled->data()) {
+            write_word(bits);
+        }
+        for (uint64_t sample : _samples) {
+            write_word(sample);
+        }
+        if (!file) {
+            throw std::runtime_error("Error writing file: " + filename);
+        }
+    }
+
+    /**
+     * @brief Restituisce la lunghezza del testo indicizzato.
+     * @return Numero di caratteri.
+     */
+    uint64_t size() const {
+        return _n;
+    }
+
+    /**
+     * @brief Verifica che l'indice corrisponda al testo dato (lunghezza e checksum).
+     * @param text Testo.
+     * @return true se lunghezza e checksum coincidono.
+     */
+    bool matches(std::string_view text) const {
+        return text.size() == _n && text_fingerprint(text) == _checksum;
+    }
+
+    /**
+     * @brief Calcola l'intervallo di righe [inizio, fine) dei suffissi che hanno pattern come prefisso.
+     * @param pattern Pattern da cercare.
+     * @return L'intervallo di righe, vuoto se il pattern non occorre; tutti i suffissi non vuoti per il pattern vuoto.
+     */
+    std::pair<uint64_t, uint64_t> find(std::string_view pattern) const {
+        if (pattern.empty()) {
+            return {1, _n + 1};
+        }
+        uint64_t begin = 0, end = _n + 1;
+        for (std::size_t i = pattern.size(); i-- > 0 && begin < end; ) {
+            uint16_t symbol = _code[static_cast<unsigned char>(pattern[i])];
+            if (symbol == 0) {
+                return {0, 0};
+            }
+            begin = _counts[symbol] + _bwt.rank(symbol, begin);
+            end = _counts[symbol] + _bwt.rank(symbol, end);
+        }
+        return begin < end ? std::make_pair(begin, end) : std::make_pair(uint64_t(0), uint64_t(0));
+    }
+
+    /**
+     * @brief Conta le occorrenze di un pattern nel testo.
+     * @param pattern Pattern da cercare.
+     * @return Numero di occorrenze.
+     */
+    uint64_t count(std::string_view pattern) const {
+        auto [begin, end] = find(pattern);
+        return end - begin;
+    }
+
+    /**
+     * @brief Restituisce la posizione nel testo del suffisso di una riga.
+     * @param row Riga, tra 1 e n.
+     * @return La posizione del suffisso.
+     */
+    uint64_t locate_row(uint64_t row) const {
+        uint64_t steps = 0;
+        while (!(*_sampled)[row]) {
+            row = lf(row);
+            ++steps;
+        }
+        return _samples[_sampled_rank.rank1(row)] + steps;
+    }
+
+    /**
+     * @brief Restituisce le posizioni delle occorrenze di un pattern, nell'ordine del suffix array.
+     * @param pattern Pattern da cercare.
+     * @return Le posizioni delle occorrenze.
+     */
+    std::vector<uint64_t> locate(std::string_view pattern) const {
+        auto [begin, end] = find(pattern);
+        std::vector<uint64_t> positions;
+        positions.reserve(end - begin);
+        for (uint64_t row = begin; row < end; ++row) {
+            positions.push_back(locate_row(row));
+        }
+        return positions;
+    }
+};
+
+#endif //ICFL_FM_INDEX_HPP
@@ -6,83 +6,193 @@
 #include <pasta/bit_vector/bit_vector.hpp>
 #include <pasta/bit_vector/support/flat_rank_select.hpp>
 #include <tree.hh>
+#include <tlx/thread_pool.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <list>
+#include <memory>
 #include <string>
-#include <fstream>
+#include <span>
+#include <string_view>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 #include "tree.hpp"
 #include "node.hpp"
+#include "collection.hpp"
+#include "factorization.hpp"
+#include "fingerprint.hpp"
+#include "logging.hpp"
+#include "mapped_file.hpp"
+#include "position.hpp"
+#include "sais.hpp"
 
 /**
- * @brief Costruisce e restituisce una lista di stringhe da un file di testo.
+ * @brief Costruisce e restituisce una fattorizzazione da un file di testo.
  *
- * Questa funzione legge da un file di testo il numero di nodi seguito da una serie di stringhe e costruisce una
- * lista di stringhe con i contenuti letti dal file.
+ * Il file contiene il numero di fattori seguito da un fattore per riga. Il file viene mappato in memoria
+ * e scandito con memchr: una prima passata individua i confini delle righe, una seconda copia i fattori,
+ * gia' concatenati, in un unico buffer allocato una sola volta. I caratteri di fine riga non fanno parte
+ * del testo, quindi questa copia e' l'unica effettuata; non vengono creati oggetti per i singoli fattori.
  * Se il file non può essere aperto o se si verificano errori durante la lettura, viene lanciata un'eccezione
  * std::runtime_error.
  *
  * @param filename Il nome del file di testo da leggere.
- * @return Una lista di stringhe contenente i dati letti dal file.
+ * @return La fattorizzazione letta dal file.
  * @throw std::runtime_error Se si verificano errori durante l'apertura del file o durante la lettura dei dati.
  */
-std::list<std::string> build_input_ICFL(const std::string& filename) {
-    std::ifstream file(filename);
-    std::list<std::string> icfl_t;
+Factorization build_input_ICFL(const std::string& filename) {
+    MappedFile file(filename);
+    std::string_view buffer = file.text();
+
+    std::size_t num_factors = 0;
+    auto [count_end, error] = std::from_chars(buffer.data(), buffer.data() + buffer.size(), num_factors);
+    if (error != std::errc()) {
+        throw std::runtime_error("Error reading file: " + filename);
+    }
+    std::size_t cursor = count_end - buffer.data() + 1; // il carattere di nuova riga dopo il numero
+
+    // Confini [inizio, fine) di ogni riga nel file.
+    std::vector<std::pair<std::size_t, std::size_t>> lines;
+    lines.reserve(num_factors);
+    std::size_t length = 0;
+    while (lines.size() < num_factors && cursor < buffer.size()) {
+        const void* newline = std::memchr(buffer.data() + cursor, '\n', buffer.size() - cursor);
+        std::size_t end = newline ? static_cast<const char*>(newline) - buffer.data() : buffer.size();
+        lines.emplace_back(cursor, end);
+        length += end - cursor;
+        cursor = end + 1;
+    }
+    if (lines.size() < num_factors) {
+        throw std::runtime_error("Error reading file: " + filename + " (missing factors)");
+    }
 
-    if(file.is_open()){
-        int num_nodes;
-        if (!(file >> num_nodes)) {
-            throw std::runtime_error("Errore reading file: " + filename);
-        }
-        file.ignore(); // Ignora il carattere di nuova riga dopo l'intero
-        for (int i = 0; i < num_nodes; ++i) {
-            std::string node_data;
-            if (!std::getline(file, node_data)) {
-                throw std::runtime_error("Error.");
-            }
-            icfl_t.push_back(node_data);
-        }
-        file.close();
+    std::string text(length, '\0');
+    std::vector<uint64_t> starts;
+    starts.reserve(num_factors);
+    std::size_t offset = 0;
+    for (auto [begin, end] : lines) {
+        starts.push_back(offset);
+        std::memcpy(text.data() + offset, buffer.data() + begin, end - begin);
+        offset += end - begin;
     }
-    else{
+    return Factorization(std::move(text), starts);
+}
+
+/**
+ * @brief Scrive una fattorizzazione nel formato letto da build_input_ICFL(): il numero di fattori seguito da
+ * un fattore per riga.
+ *
+ * @param filename Il nome del file da scrivere.
+ * @param icfl_t La fattorizzazione; i fattori non devono contenere caratteri di nuova riga.
+ * @throw std::invalid_argument Se un fattore contiene un carattere di nuova riga.
+ * @throw std::runtime_error Se il file non puo' essere scritto.
+ */
+void write_factor_file(const std::string& filename, const Factorization& icfl_t) {
+    if (icfl_t.text().find('\n') != std::string_view::npos) {
+        throw std::invalid_argument("Factors containing newlines cannot be written to a factor file");
+    }
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
         throw std::runtime_error("Cannot open file: " + filename);
     }
-    return icfl_t;
+    file << icfl_t.size() << '\n';
+    for (std::size_t i = 0; i < icfl_t.size(); ++i) {
+        file << icfl_t.factor(i) << '\n';
+    }
+    if (!file) {
+        throw std::runtime_error("Error writing file: " + filename);
+    }
+}
+
+/**
+ * @brief Mappa in memoria un file di testo grezzo e ne calcola la ICFL.
+ *
+ * Il contenuto viene usato cosi' com'e', senza rimuovere separatori o caratteri di fine riga, e non viene
+ * copiato: la fattorizzazione mantiene la mappatura del file.
+ *
+ * @param filename Il nome del file da leggere.
+ * @return La fattorizzazione ICFL del contenuto del file.
+ * @throw std::runtime_error Se il file non puo' essere aperto o mappato.
+ */
+Factorization factorize_input_text(const std::string& filename) {
+    return factorize_ICFL(MappedFile(filename));
 }
 
 /**
- * @brief Costruisce una stringa concatenando tutti gli elementi di una lista di stringhe.
+ * @brief Legge una collezione di documenti da un file, un documento per riga.
  *
- * Questa funzione scorre attraverso una lista di stringhe, concatenando ciascun elemento in un'unica stringa finale.
+ * Il file viene mappato in memoria e scandito con memchr come in build_input_ICFL(): i documenti sono
+ * copiati, gia' concatenati, in un unico buffer. I caratteri di fine riga non fanno parte dei documenti;
+ * una riga vuota finale, dopo l'ultimo carattere di nuova riga, viene ignorata.
  *
- * @param icfl_t La lista di stringhe da concatenare.
- * @return Una stringa che contiene tutti gli elementi della lista concatenati.
+ * @param filename Il nome del file da leggere.
+ * @return La collezione letta dal file.
+ * @throw std::runtime_error Se il file non puo' essere aperto o mappato.
  */
-std::string build_text_from_ICFL(std::list<std::string> &icfl_t){
-    auto it = icfl_t.begin();
-    std::string text = "";
-    while(it != icfl_t.end()){
-        text = text + *it;
-        ++it;
+Collection build_input_collection(const std::string& filename) {
+    MappedFile file(filename);
+    std::string_view buffer = file.text();
+
+    std::string text;
+    text.reserve(buffer.size());
+    std::vector<uint64_t> starts;
+    std::size_t cursor = 0;
+    while (cursor < buffer.size()) {
+        const void* newline = std::memchr(buffer.data() + cursor, '\n', buffer.size() - cursor);
+        std::size_t end = newline ? static_cast<const char*>(newline) - buffer.data() : buffer.size();
+        starts.push_back(text.size());
+        text.append(buffer.data() + cursor, end - cursor);
+        cursor = end + 1;
     }
-    return text;
+    return Collection(std::move(text), std::move(starts));
+}
+
+/**
+ * @brief Legge un file di testo grezzo e ne restituisce il contenuto.
+ *
+ * Il contenuto viene letto cosi' com'e', senza rimuovere separatori o caratteri di fine riga.
+ *
+ * @param filename Il nome del file da leggere.
+ * @return Il testo contenuto nel file.
+ * @throw std::runtime_error Se il file non puo' essere aperto.
+ */
+std::string build_input_text(const std::string& filename) {
+    return std::string(MappedFile(filename).text());
 }
 
 /**
- * @brief Costruisce e restituisce una lista di stringhe di esempio.
+ * @brief Restituisce il testo concatenato di una fattorizzazione.
+ *
+ * I fattori sono gia' memorizzati in un unico buffer, quindi il testo viene solo copiato.
  *
- * Costruisce una lista di stringhe di esempio e la restituisce.
+ * @param icfl_t La fattorizzazione.
+ * @return Una stringa che contiene tutti i fattori concatenati.
+ */
+std::string build_text_from_ICFL(const Factorization &icfl_t){
+    return std::string(icfl_t.text());
+}
+
+/**
+ * @brief Costruisce e restituisce una fattorizzazione di esempio.
+ *
+ * Costruisce una fattorizzazione di esempio e la restituisce.
  * ICFL(T) = < aaa baa caabca dcaabca >
  *
- * @return Lista di stringhe.
+ * @return La fattorizzazione di esempio.
  */
-std::list<std::string> build_ICFL(){
-    std::list<std::string> icfl_text;
-    icfl_text.push_back("aaa");
-    icfl_text.push_back("baa");
-    icfl_text.push_back("caabca");
-    icfl_text.push_back("dcaabca");
-    return icfl_text;
+Factorization build_ICFL(){
+    return Factorization(std::string("aaabaacaabcadcaabca"), std::vector<uint64_t>{0, 3, 6, 12});
 }
 
 /**
@@ -134,6 +244,19 @@ void print_list(std::list<T> &list){
     std::cout << "] " << std::endl;
 }
 
+/**
+ * @brief Stampa i fattori di una fattorizzazione.
+ *
+ * @param icfl_t Fattorizzazione da stampare.
+ */
+void print_factorization(const Factorization &icfl_t){
+    std::cout << " [ ";
+    for (std::size_t i = 0; i < icfl_t.size(); ++i) {
+        std::cout << icfl_t.factor(i) << " ";
+    }
+    std::cout << "] " << std::endl;
+}
+
 /**
  * @brief Stampa i bit presenti in un oggetto BitVector.
  *
@@ -150,21 +273,56 @@ void print_bv(const pasta::BitVector &bv) {
 }
 
 /**
- * @brief Stampa il contenuto di un vettore g_list.
- * @param g_list Vettore di interi da stampare.
- *
- * Questa funzione prende un vettore di interi e stampa il suo contenuto
- * in formato [ elemento1 elemento2 ... elementoN ].
+ * @brief Restituisce il contenuto di un vettore g_list in formato [elemento1, elemento2, ..., elementoN].
+ * @tparam Position Tipo delle posizioni.
+ * @param g_list Vettore di posizioni da formattare.
+ * @return Stringa con il contenuto del vettore.
  */
-void print_g_list_vector(const std::vector<int>& g_list) {
-    std::cout << "[";
+template <typename Position>
+std::string g_list_to_string(std::span<const Position> g_list) {
+    std::ostringstream os;
+    os << "[";
     for (size_t i = 0; i < g_list.size(); ++i) {
-        std::cout << g_list[i];
+        os << static_cast<uint64_t>(g_list[i]);
         if (i != g_list.size() - 1) {
-            std::cout << ", ";
+            os << ", ";
         }
     }
-    std::cout << "]" << std::endl;
+    os << "]";
+    return os.str();
+}
+
+/**
+ * @brief Restituisce un suffix array generalizzato in formato [(documento, offset), ...].
+ * @tparam Position Tipo delle posizioni.
+ * @param suffixes Suffissi da formattare, nell'ordine del suffix array generalizzato.
+ * @return Stringa con le coppie (documento, offset).
+ */
+template <typename Position>
+std::string document_suffixes_to_string(std::span<const DocumentSuffix<Position>> suffixes) {
+    std::ostringstream os;
+    os << "[";
+    for (size_t i = 0; i < suffixes.size(); ++i) {
+        os << "(" << static_cast<uint64_t>(suffixes[i].document) << ", " << static_cast<uint64_t>(suffixes[i].offset) << ")";
+        if (i != suffixes.size() - 1) {
+            os << ", ";
+        }
+    }
+    os << "]";
+    return os.str();
+}
+
+/**
+ * @brief Stampa il contenuto di un vettore g_list.
+ * @tparam Position Tipo delle posizioni.
+ * @param g_list Vettore di posizioni da stampare.
+ *
+ * Questa funzione prende un vettore di posizioni e stampa il suo contenuto
+ * in formato [ elemento1 elemento2 ... elementoN ].
+ */
+template <typename Position>
+void print_g_list_vector(std::span<const Position> g_list) {
+    std::cout << g_list_to_string<Position>(g_list) << std::endl;
 }
 
 /**
@@ -196,101 +354,115 @@ void print_node_map(const std::unordered_map<std::string, std::string>& map) {
 }
 
 /**
- * @brief Trova l'elemento all'indice specificato in una lista.
+ * @brief Calcola e restituisce il punto di inserimento "insertion target" in base ai parametri forniti.
+ *
+ * Le occorrenze di x nei fattori m_0, ..., m_{k-1} compaiono nella g-list di x in ordine di fattore, che
+ * coincide con l'ordine dei suffissi globali x m_{q+1} ... m_k; l'eventuale occorrenza nell'ultimo fattore
+ * le precede tutte. Le prosecuzioni m_{q+1} ... m_k, troncate a |y| caratteri, sono quindi ordinate e il
+ * punto di inserimento, la prima occorrenza la cui prosecuzione non e' minore di y, si trova con una ricerca
+ * binaria sulle occorrenze (select1 sull'insieme delle occorrenze di x, denso o sparso), confrontando viste
+ * sul testo senza allocazioni.
  *
- * Questa funzione cerca l'elemento all'indice specificato nella lista data e restituisce un iteratore
- * alla sua posizione se trovato. Se l'indice specificato è fuori dall'intervallo della lista,
- * viene lanciata un'eccezione std::out_of_range.
+ * Il costo e' O(log occ * |y|), dove occ e' il numero di occorrenze di x.
  *
- * @tparam T Il tipo degli elementi memorizzati nella lista.
- * @param list La lista in cui effettuare la ricerca.
- * @param i L'indice dell'elemento da trovare.
- * @return Un iteratore alla posizione dell'elemento all'indice specificato se trovato.
- * @throw std::out_of_range se l'indice specificato è fuori dall'intervallo della lista.
+ * @param x_occ Insieme dei fattori in cui occorre il suffisso x.
+ * @param icfl_t Fattorizzazione ICFL.
+ * @param y Suffisso di z.
+ * @return Punto di inserimento calcolato.
  */
-template <typename T>
-typename std::list<T>::iterator find_node(std::list<T> &list, unsigned int i){
-    unsigned int count = 0;
-    auto it = list.begin();
-    while (it != list.end()) {
-        if (count == i){
-            return it;
+std::size_t getInsertionTarget(const OccurrenceSet& x_occ, const Factorization &icfl_t, std::string_view y){
+    std::string_view text = icfl_t.text();
+    std::size_t k = x_occ.size() - 1;
+    std::size_t last = x_occ.contains(k) ? 1 : 0;
+
+    // Prima occorrenza p >= 1 fuori dall'ultimo fattore con i primi |y| caratteri della prosecuzione >= y.
+    std::size_t lo = 1, hi = x_occ.rank1(k) + 1;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (text.substr(icfl_t.end(x_occ.select1(mid)), y.size()) < y) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-        ++it;
-        ++count;
     }
-    throw std::out_of_range("Indice fuori dalla lista");
+    return last + lo - 1;
 }
 
 /**
- * @brief Calcola e restituisce il punto di inserimento "insertion target" in base ai parametri forniti.
+ * @brief Conta le occorrenze di x, a partire dall'insertion target, la cui prosecuzione inizia con y.
  *
- * Calcola e restituisce il punto di inserimento "insertion target" in base ai parametri forniti.
+ * Queste occorrenze sono prefissate da z = xy: i loro suffissi globali non precedono ne' seguono in blocco
+ * quelli di z, ma vi si intercalano in base al testo che segue z, per cui vanno fusi con la g-list di z
+ * confrontando i suffissi (vedi merge_overlap()). Ad esempio in ababcab, con ICFL a | bab | cab, il suffisso
+ * 0 di x = a va posto tra i suffissi 5 e 2 di z = ab. Il numero di occorrenze, di solito piccolo, si trova
+ * con una ricerca galoppante a partire dall'insertion target.
  *
- * @param b_x BitVector associato al suffiso x.
- * @param b_z BitVector associato al suffisso z = xy.
- * @param icfl_t Lista di stringhe ICFL.
+ * @param x_occ Insieme dei fattori in cui occorre il suffisso x.
+ * @param icfl_t Fattorizzazione ICFL.
  * @param y Suffisso di z.
- * @return Punto di inserimento calcolato.
+ * @param target Insertion target calcolato da getInsertionTarget().
+ * @return Numero di occorrenze di x da fondere con la g-list di z.
  */
-unsigned int getInsertionTarget(pasta::BitVector& b_x, pasta::BitVector& b_z, std::list<std::string> &icfl_t, const std::string& y){
-    unsigned int i = 0, k = 0, u = 0, p = 0, s = 0, q = 0, h = 0;
-    std::string alpha;
-
-    pasta::FlatRankSelect rs_x(b_x);
-    pasta::FlatRankSelect rs_z(b_z);
-
-    std::cout << std::endl;
-
-    i = rs_z.select1(1);
-    k = b_x.size() - 1;
-    s = b_x[k] + 1;
-
-
-    if(i == 0){
-        u = rs_x.rank1(i) + b_x[k] + 1;
+std::size_t getInsertionOverlap(const OccurrenceSet& x_occ, const Factorization &icfl_t, std::string_view y,
+                                std::size_t target){
+    std::string_view text = icfl_t.text();
+    std::size_t k = x_occ.size() - 1;
+    std::size_t candidates = x_occ.rank1(k);
+    std::size_t first = target - (x_occ.contains(k) ? 1 : 0) + 1;
+
+    // Primi |y| caratteri della prosecuzione della p-esima occorrenza di x (p >= 1) fuori dall'ultimo fattore.
+    auto alpha = [&](std::size_t p) {
+        return text.substr(icfl_t.end(x_occ.select1(p)), y.size());
+    };
+
+    // Prima occorrenza con alpha > y: ricerca galoppante a partire da first.
+    std::size_t lo = first, hi = first, step = 1;
+    while (hi <= candidates && alpha(hi) == y) {
+        lo = hi + 1;
+        hi = first + step;
+        step *= 2;
     }
-    else if(i < k){
-        u = rs_x.rank1(i-1) + b_x[k] + 1;
+    if (hi > candidates + 1) {
+        hi = candidates + 1;
     }
-    else{
-        u = rs_x.rank1(b_x.size()) + 1;
-    }
-
-    p = u - 1;
-
-    while(p > s){
-        q = rs_x.select1(p - b_x[k]);
-        alpha = (*find_node(icfl_t, q+1)).substr(0,y.size());
-        if(alpha <= y){
-            p = s - 1;
-        }
-        else{
-            p = p - 1;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (alpha(mid) == y) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
+    return lo - first;
+}
 
-    //h = p + 1;
-    //return h;
-    return p;
+/**
+ * @brief Calcola il punto di inserimento costruendo al momento il supporto rank/select.
+ *
+ * @param b_x BitVector associato al suffiso x.
+ * @param icfl_t Fattorizzazione ICFL.
+ * @param y Suffisso di z.
+ * @return Punto di inserimento calcolato.
+ */
+std::size_t getInsertionTarget(pasta::BitVector& b_x, const Factorization &icfl_t, std::string_view y){
+    OccurrenceSet::rank_select_type rs_x(b_x);
+    return getInsertionTarget(OccurrenceSet(b_x, rs_x), icfl_t, y);
 }
 
 /**
- * @brief Calcola e restituisce la lunghezza massima delle stringhe in una lista.
+ * @brief Calcola e restituisce la lunghezza massima dei fattori di una fattorizzazione.
  *
- * Questa funzione scorre attraverso una lista di stringhe e determina la lunghezza massima tra tutte le stringhe presenti nella lista.
+ * Questa funzione scorre gli offset dei fattori e determina la lunghezza massima tra tutti i fattori.
  *
- * @param icfl_t La lista di stringhe da esaminare.
- * @return La lunghezza massima tra tutte le stringhe nella lista.
+ * @param icfl_t La fattorizzazione da esaminare.
+ * @return La lunghezza massima tra tutti i fattori.
  */
-unsigned int get_maximum_length_from_factors(std::list<std::string> &icfl_t){
+unsigned int get_maximum_length_from_factors(const Factorization &icfl_t){
     unsigned int max = 0;
-    auto it = icfl_t.begin();
-    while(it != icfl_t.end()){
-        if (it->size() > max){
-            max = it->size();
+    for (std::size_t i = 0; i < icfl_t.size(); ++i) {
+        if (icfl_t.length(i) > max){
+            max = icfl_t.length(i);
         }
-        ++it;
     }
     return max;
 }
@@ -304,8 +476,8 @@ unsigned int get_maximum_length_from_factors(std::list<std::string> &icfl_t){
  * Questa funzione controlla se s2 è un prefisso di s1. Se lo è, restituisce la parte di s1 che rimane
  * dopo aver rimosso il prefisso s2. Se s2 non è un prefisso di s1, restituisce s1 intera.
  */
-std::string get_strings_difference(const std::string& s1, const std::string& s2) {
-    if (s1.find(s2) == 0) {
+std::string_view get_strings_difference(std::string_view s1, std::string_view s2) {
+    if (s1.starts_with(s2)) {
         return s1.substr(s2.length());
     } else {
         return s1;
@@ -332,6 +504,7 @@ void print_suffix_map(const std::unordered_map<std::string, std::vector<int>>& s
 
 /**
  * @brief Trova il nodo più profondo che ha un suffisso prefisso del suffisso dato.
+ * @tparam Position Tipo delle posizioni dei nodi.
  * @param node Puntatore al nodo da cui iniziare la ricerca.
  * @param suffix Il suffisso da cercare.
  * @return Puntatore al nodo più profondo il cui suffisso è un prefisso del suffisso dato.
@@ -339,10 +512,11 @@ void print_suffix_map(const std::unordered_map<std::string, std::vector<int>>& s
  * Questa funzione ricorsiva attraversa l'albero a partire dal nodo dato, cercando il nodo più profondo
  * il cui suffisso è un prefisso del suffisso dato. Se nessun figlio soddisfa la condizione, restituisce il nodo corrente.
  */
-Node* find_deepest_prefix_node(Node* node, const std::string suffix) {
-    for (Node* child : node->get_children()) {
-        std::string figlio = child->get_suffix();
-        if (suffix.find(figlio) == 0) {
+template <typename Position>
+BasicNode<Position>* find_deepest_prefix_node(BasicNode<Position>* node, std::string_view suffix) {
+    for (BasicNode<Position>* child : node->get_children()) {
+        std::string_view figlio = child->get_suffix();
+        if (suffix.starts_with(figlio)) {
             return find_deepest_prefix_node(child, suffix);
         }
     }
@@ -351,11 +525,13 @@ Node* find_deepest_prefix_node(Node* node, const std::string suffix) {
 
 /**
  * @brief Stampa l'albero a partire dal nodo specificato.
+ * @tparam Position Tipo delle posizioni dei nodi.
  * @param node Puntatore al nodo da cui iniziare la stampa.
  * @param prefix Prefisso della riga corrente (per formattazione).
  * @param is_last True se il nodo è l'ultimo figlio.
  */
-void print_tree(Node *node, std::string prefix = "", bool is_last = true) {
+template <typename Position>
+void print_tree(BasicNode<Position> *node, std::string prefix = "", bool is_last = true) {
 
     std::cout << prefix;
 
@@ -376,89 +552,228 @@ void print_tree(Node *node, std::string prefix = "", bool is_last = true) {
 }
 
 /**
- * @brief Costruisce un albero a partire da una lista di stringhe.
- * @param icfl_t Lista di stringhe che rappresentano i fattori da cui costruire l'albero.
+ * @brief Occorrenze di un suffisso locale di una data lunghezza, raccolte durante la scansione dei fattori.
+ * @tparam Position Tipo delle posizioni.
+ */
+template <typename Position>
+struct SuffixBucket {
+    std::vector<Position> g_list; ///< Posizioni delle occorrenze, in ordine di fattore.
+    std::vector<uint32_t> factors; ///< Indici dei fattori che terminano con il suffisso, in ordine crescente.
+};
+
+/**
+ * @brief Esegue function su intervalli contigui di [0, n), in parallelo sui thread del pool.
+ *
+ * L'intervallo viene diviso in tante parti quanti sono i thread del pool (una sola parte, eseguita dal
+ * thread chiamante, se pool e' nullptr); la funzione ritorna quando tutte le parti sono state elaborate.
+ *
+ * @param pool Pool di thread, oppure nullptr per l'esecuzione sequenziale.
+ * @param n Numero di elementi.
+ * @param function Funzione invocata come function(inizio, fine, parte).
+ */
+template <typename Function>
+void parallel_for(tlx::ThreadPool* pool, std::size_t n, const Function& function) {
+    if (pool == nullptr || n < 2) {
+        function(std::size_t(0), n, std::size_t(0));
+        return;
+    }
+    std::size_t parts = std::min(pool->size(), n);
+    for (std::size_t p = 0; p < parts; ++p) {
+        std::size_t begin = n * p / parts;
+        std::size_t end = n * (p + 1) / parts;
+        pool->enqueue([&function, begin, end, p]() { function(begin, end, p); });
+    }
+    pool->loop_until_empty();
+}
+
+/**
+ * @brief Costruisce un albero a partire da una fattorizzazione.
+ * @tparam Position Tipo delle posizioni nel testo, sufficiente a rappresentarne la lunghezza (vedi position.hpp).
+ * @param icfl_t Fattorizzazione ICFL da cui costruire l'albero; il suo testo viene spostato nell'albero.
+ * @param threads Numero di thread da utilizzare (1 per la costruzione sequenziale).
  * @return L'albero costruito.
+ * @throw std::invalid_argument Se Position non puo' rappresentare le posizioni del testo o se i fattori
+ *        sono piu' di 2^32 - 1, perche' gli insiemi delle occorrenze li indicizzano a 32 bit.
  *
  * Questa funzione costruisce un suffix tree utilizzando i fattori forniti in input. Per ogni lunghezza
  * del suffisso (da 0 alla lunghezza massima dei fattori), itera sui fattori per estrarre i suffissi
  * e aggiornare le mappe dei suffissi e dei bit. Successivamente, trova il nodo genitore più profondo
  * per ogni suffisso, determina l'insertion target e crea un nuovo nodo figlio. Il processo viene ripetuto
  * fino a completare la costruzione dell'albero.
+ *
+ * Con piu' thread (tlx::ThreadPool) i fattori vengono divisi in intervalli contigui, ognuno scandito con
+ * una mappa locale; le mappe sono poi fuse nell'ordine degli intervalli, quindi le g-list restano in
+ * ordine di fattore. Anche la ricerca del genitore e il calcolo degli insertion target dei suffissi di
+ * una stessa lunghezza sono eseguiti in parallelo: i genitori hanno lunghezza minore, quindi l'albero
+ * non cambia durante queste fasi. La creazione dei nodi, che alloca nell'arena dell'albero, e la
+ * costruzione del supporto rank/select dei genitori restano sequenziali.
+ *
+ * Le chiavi delle mappe sono viste sul testo dell'albero, con il fingerprint di Karp-Rabin del suffisso
+ * aggiornato in O(1) a ogni lunghezza: non vengono allocate stringhe e l'hash non rilegge il suffisso.
  */
-Tree build_tree(std::list<std::string>& icfl_t){
-    Tree tree (icfl_t);
+template <typename Position = uint32_t>
+BasicTree<Position> build_tree(Factorization factorization, unsigned int threads = 1){
+    using Node = BasicNode<Position>;
+    if (factorization.text().size() > max_position<Position>()) {
+        throw std::invalid_argument("Text too long for the position type");
+    }
+    if (factorization.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("Too many factors: at most 2^32 - 1 are supported");
+    }
+    BasicTree<Position> tree (std::move(factorization));
+    const Factorization& icfl_t = tree.get_icfl();
     Node *root = tree.get_root();
-    unsigned int insertion_target = 0;
+    const std::size_t k = icfl_t.size();
 
-    std::unordered_map<std::string, std::vector<int>> suffix_map;
-    std::unordered_map<std::string, pasta::BitVector> bit_map;
+    std::unique_ptr<tlx::ThreadPool> pool;
+    if (threads > 1) {
+        pool = std::make_unique<tlx::ThreadPool>(threads);
+    }
+    using Bucket = SuffixBucket<Position>;
+    using SuffixMap = std::unordered_map<SuffixKey, Bucket, SuffixKeyHash>;
+    std::vector<SuffixMap> suffix_maps(pool ? pool->size() : 1);
+
+    // Fingerprint del suffisso corrente di ogni fattore, esteso di un carattere a ogni lunghezza.
+    std::vector<uint64_t> fingerprints(k, 0);
+    uint64_t power = 1; // B^l
+    std::string_view text = icfl_t.text();
 
     unsigned int max_length = get_maximum_length_from_factors(icfl_t);
 
     for (unsigned int l = 0; l < max_length; ++l) {
-        std::string suffix = "";
-        unsigned int total_length = 0;
-
-        for (unsigned int i = 0; i < icfl_t.size(); ++i) {
-            std::string factor = *find_node(icfl_t, i);
-            total_length += factor.size();
-            unsigned int occ = 0;
-
-            if (l < factor.length()) {
-                int start = factor.length() - (l + 1);
-                suffix = factor.substr(start, l + 1);
-                occ = total_length - (l + 1);
-
-                if (suffix_map.find(suffix) == suffix_map.end()) {
-                    std::vector<int> suffix_g_list;
-                    suffix_map.emplace(suffix, suffix_g_list);
-                    suffix_map[suffix].push_back(occ);
-
-                    // Try_emplace instead of emplace
-                    bit_map.try_emplace(suffix, icfl_t.size(), 0);
-                } else {
-                    if (i != icfl_t.size() - 1) {
-                        suffix_map[suffix].push_back(occ);
-                    } else {
-                        suffix_map[suffix].insert(suffix_map[suffix].begin(), occ); // push front
-                    }
+
+        parallel_for(pool.get(), k, [&](std::size_t begin, std::size_t end, std::size_t part) {
+            SuffixMap& suffix_map = suffix_maps[part];
+            for (std::size_t i = begin; i < end; ++i) {
+                if (l < icfl_t.length(i)) {
+                    std::size_t start = icfl_t.end(i) - (l + 1);
+                    fingerprints[i] = fingerprint_prepend(text[start], fingerprints[i], power);
+                    Bucket& bucket = suffix_map[SuffixKey{text.substr(start, l + 1), fingerprints[i]}];
+                    bucket.g_list.push_back(icfl_t.end(i) - (l + 1));
+                    bucket.factors.push_back(i);
+                }
+            }
+        });
+
+        // Fusione delle mappe locali nell'ordine dei fattori.
+        SuffixMap& suffix_map = suffix_maps[0];
+        for (std::size_t part = 1; part < suffix_maps.size(); ++part) {
+            for (auto& entry : suffix_maps[part]) {
+                auto [it, inserted] = suffix_map.try_emplace(entry.first, std::move(entry.second));
+                if (!inserted) {
+                    Bucket& bucket = it->second;
+                    bucket.g_list.insert(bucket.g_list.end(), entry.second.g_list.begin(), entry.second.g_list.end());
+                    bucket.factors.insert(bucket.factors.end(), entry.second.factors.begin(), entry.second.factors.end());
                 }
-                bit_map[suffix][i] = 1;
             }
+            suffix_maps[part].clear();
         }
 
-        for(auto& entry : suffix_map) {
-            std::string s = entry.first;
-            Node* parent = find_deepest_prefix_node(root, entry.first);
+        std::vector<typename SuffixMap::value_type*> entries;
+        entries.reserve(suffix_map.size());
+        for (auto& entry : suffix_map) {
+            // L'occorrenza nell'ultimo fattore precede le altre.
+            Bucket& bucket = entry.second;
+            if (bucket.factors.back() == k - 1) {
+                std::rotate(bucket.g_list.begin(), bucket.g_list.end() - 1, bucket.g_list.end());
+            }
+            entries.push_back(&entry);
+        }
+
+        std::vector<Node*> parents(entries.size());
+        parallel_for(pool.get(), entries.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t e = begin; e < end; ++e) {
+                parents[e] = find_deepest_prefix_node(root, entries[e]->first.suffix);
+            }
+        });
+
+        // Il supporto rank/select viene costruito al primo utilizzo: lo si prepara prima della fase parallela.
+        for (Node* parent : parents) {
+            parent->get_occurrences();
+        }
+
+        std::vector<std::size_t> targets(entries.size()), overlaps(entries.size());
+        parallel_for(pool.get(), entries.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t e = begin; e < end; ++e) {
+                const Node* parent = parents[e];
+                std::string_view y = get_strings_difference(entries[e]->first.suffix, parent->get_suffix());
+                targets[e] = getInsertionTarget(parent->get_occurrences(), icfl_t, y);
+                overlaps[e] = getInsertionOverlap(parent->get_occurrences(), icfl_t, y, targets[e]);
+            }
+        });
+
+        for (std::size_t e = 0; e < entries.size(); ++e) {
+            const Bucket& bucket = entries[e]->second;
+            Node* parent = parents[e];
 
             //PRINTS FOR DEBUGGING
             /*
             std::cout << s << " & " << parent->get_suffix() << " = " << get_strings_difference(s, parent->get_suffix()) << std::endl;
             print_bv(*(parent->get_bv_pointer()));
-            print_bv(bit_map[s]);
             //print_list(icfl_t);
             */
 
-            insertion_target = getInsertionTarget(*parent->get_bv_pointer(), bit_map[s], icfl_t,
-                                                  get_strings_difference(s, parent->get_suffix()));
-
-            std::pair<unsigned int, unsigned int> indexes(suffix_map[s][0], suffix_map[s][0] + (l + 1));
-            Node *child = new Node(root, parent, {}, indexes, entry.second, insertion_target, &bit_map[s]);
+            std::pair<Position, Position> indexes(bucket.g_list[0], bucket.g_list[0] + (l + 1));
+            Node *child = tree.create_node(parent, indexes, std::span<const Position>(bucket.g_list), 0, bucket.factors);
+            if (parent == root) {
+                // Gli insiemi dei suffissi piu' corti sono i piu' grandi e i piu' consultati: compressi restano in cache.
+                child->compress_occurrences();
+            }
+            child->set_insertion_target(targets[e], overlaps[e]);
             parent->add_child(child);
-            child->print_data();
 
-            //clear the buffer
-            std::cout << std::endl;
+            LOGC(log_enabled(Verbosity::nodes))
+                << "node " << *child << " (parent " << *parent << "): g-list " << g_list_to_string<Position>(child->get_g_list())
+                << ", insertion target " << targets[e] << ", overlap " << overlaps[e];
         }
 
-        bit_map.clear();
         suffix_map.clear();
+        power = fingerprint_mul(power, FINGERPRINT_BASE);
     }
 
     return tree;
 }
 
+/**
+ * @brief Fonde le occorrenze del genitore [first, middle) con il blocco ordinato di un figlio [middle, last).
+ *
+ * Tutti i suffissi coinvolti iniziano con il suffisso z del figlio, quindi i confronti partono dopo i primi
+ * `common` caratteri. Le occorrenze del genitore, di solito poche, vengono inserite nel blocco con una ricerca
+ * galoppante a partire dall'inserimento precedente: i confronti sono O(m log(b / m)) per m occorrenze e un
+ * blocco di b posizioni, invece degli m + b di una fusione lineare. Ogni confronto costa comunque quanto il
+ * prefisso comune dei due suffissi oltre z, che sui testi ripetitivi puo' essere lungo.
+ *
+ * @tparam Iterator Iteratore ad accesso casuale sulle posizioni.
+ * @param first Inizio delle occorrenze del genitore, ordinate.
+ * @param middle Inizio del blocco del figlio, ordinato.
+ * @param last Fine del blocco del figlio.
+ * @param text Testo.
+ * @param common Lunghezza del prefisso comune a tutti i suffissi (|z|).
+ */
+template <typename Iterator>
+void merge_overlap(Iterator first, Iterator middle, Iterator last, std::string_view text, std::size_t common) {
+    using Value = typename std::iterator_traits<Iterator>::value_type;
+    auto less = [text, common](uint64_t a, uint64_t b) { return text.substr(a + common) < text.substr(b + common); };
+    std::vector<Value> overlap(first, middle);
+    Iterator out = first;
+    Iterator block = middle;
+    for (const Value& a : overlap) {
+        // Prima posizione del blocco non minore di a: galoppo, poi ricerca binaria nell'ultimo passo.
+        Iterator low = block, high = block;
+        std::size_t step = 1;
+        while (high != last && less(*high, a)) {
+            low = high + 1;
+            high = static_cast<std::size_t>(last - high) > step ? high + step : last;
+            step *= 2;
+        }
+        Iterator stop = std::lower_bound(low, high, a, [&](const Value& b, const Value& value) { return less(b, value); });
+        // La destinazione precede sempre la sorgente: la copia verso sinistra e' sicura.
+        out = std::copy(block, stop, out);
+        *out++ = a;
+        block = stop;
+    }
+}
+
 /**
  * @brief Costruisce una lista inserendo la g-list di ogni nodo nella g-list del nodo genitore.
  *
@@ -466,10 +781,13 @@ Tree build_tree(std::list<std::string>& icfl_t){
  * inserendo la g-list di ciascun nodo nella g-list del nodo genitore in una posizione specificata.
  * La g-list della radice dell'albero corrisponderà al suffix-array.
  *
+ * @tparam Position Tipo delle posizioni dei nodi.
  * @param node Puntatore al nodo corrente.
  */
-void build_list(Node* node) {
-    for (int i = node->get_children().size() - 1; i >= 0; i--) {
+template <typename Position>
+void build_list(BasicNode<Position>* node) {
+    using Node = BasicNode<Position>;
+    for (std::size_t i = node->get_children().size(); i-- > 0; ) {
         build_list(node->get_children()[i]);
     }
 
@@ -477,19 +795,20 @@ void build_list(Node* node) {
     //std::cout << " ------------ " << std::endl;
     //std::cout << "analyzing " << node->get_suffix() << "..."  << std::endl;
 
-    unsigned int h = node->get_insertion_target();
+    std::size_t h = node->get_insertion_target();
+    std::size_t overlap = node->get_overlap();
     //std::cout << "insertion target: " << h << std::endl;
 
     Node* parent = node->get_parent();
     if (parent == nullptr) {
-        std::cout << "Parent node is null" << std::endl;
+        LOGC(log_enabled(Verbosity::lists)) << "Parent node is null";
         return;
     }
 
-    std::vector<int>& parent_g_list = parent->get_g_list();
-    std::vector<int>& node_g_list = node->get_g_list();
+    std::pmr::vector<Position>& parent_g_list = parent->get_g_list();
+    std::pmr::vector<Position>& node_g_list = node->get_g_list();
 
-    std::vector<int>::iterator it = parent_g_list.begin();
+    auto it = parent_g_list.begin();
     std::advance(it, h);
 
     //std::cout << "printing before: parent ";
@@ -498,18 +817,722 @@ void build_list(Node* node) {
     //print_g_list_vector(node_g_list);
 
     //insertion
-    parent_g_list.insert(it, node_g_list.begin(), node_g_list.end());
-    std::cout << "printing " << node->get_parent()->get_suffix() << " list: ";
-    print_g_list_vector(parent_g_list);
+    std::advance(it, overlap);
+    it = parent_g_list.insert(it, node_g_list.begin(), node_g_list.end());
+
+    // Le occorrenze del genitore che proseguono con il suffisso del nodo vanno fuse con la g-list inserita,
+    // confrontando i suffissi globali dopo il suffisso del nodo, comune a tutti.
+    if (overlap > 0) {
+        merge_overlap(it - overlap, it, it + node_g_list.size(), node->get_text(), node->get_suffix().size());
+    }
+    LOGC(log_enabled(Verbosity::lists))
+        << "printing " << parent->get_suffix() << " list: " << g_list_to_string<Position>(parent_g_list);
 }
 
+/**
+ * @brief Costruisce il suffix array scrivendo le g-list dei nodi direttamente in un buffer preallocato.
+ *
+ * Alternativa a build_list() che non modifica le g-list dell'albero. La lista completa di un nodo e'
+ * formata dalla sua g-list, nella quale il blocco di ogni figlio occupa la posizione indicata dal suo
+ * insertion target: la dimensione di ogni blocco e' nota dalla dimensione del sottoalbero, quindi
+ * l'intervallo del suffix array occupato da ogni nodo si calcola in anticipo e ogni posizione viene
+ * scritta una sola volta.
+ * Le eventuali occorrenze del genitore da fondere con il blocco di un figlio (overlap) vengono scritte
+ * in testa al blocco e fuse con esso dopo che il sottoalbero del figlio e' stato completato
+ * (merge_overlap()). Il loro ordine rispetto al blocco dipende dal testo che segue il suffisso del figlio e
+ * non si ricava dagli insertion target (vedi getInsertionOverlap()), quindi la fusione confronta i suffissi:
+ * il costo complessivo non e' lineare e sui testi molto ripetitivi i prefissi comuni possono essere lunghi.
+ *
+ * I nodi sono visitati in ampiezza, iterativamente: i figli di ogni nodo occupano posizioni consecutive
+ * della visita, quindi dimensioni e intervalli dei sottoalberi sono vettori indicizzati dalla posizione.
+ *
+ * @tparam Position Tipo delle posizioni dei nodi.
+ * @param root Radice dell'albero.
+ * @return Il suffix array del testo dell'albero.
+ */
+template <typename Position>
+std::vector<Position> build_suffix_array(BasicNode<Position>* root) {
+    using Node = BasicNode<Position>;
+    // Visita in ampiezza: ogni nodo precede i suoi discendenti e i figli di order[i] iniziano da first_child[i].
+    std::vector<Node*> order(1, root);
+    std::vector<std::size_t> first_child;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        first_child.push_back(order.size());
+        order.insert(order.end(), order[i]->get_children().begin(), order[i]->get_children().end());
+    }
 
+    // Dimensione della lista completa di ogni sottoalbero, calcolata dalle foglie verso la radice.
+    std::vector<std::size_t> subtree_size(order.size());
+    for (std::size_t i = order.size(); i-- > 0; ) {
+        std::size_t size = order[i]->get_g_list().size();
+        for (std::size_t c = 0; c < order[i]->get_children().size(); ++c) {
+            size += subtree_size[first_child[i] + c];
+        }
+        subtree_size[i] = size;
+    }
 
+    std::vector<Position> sa(subtree_size[0]);
+    std::vector<std::size_t> offset(order.size(), 0);
+
+    // Intervalli [inizio, meta', fine) da fondere e lunghezza del suffisso del figlio, comune a tutto l'intervallo.
+    std::vector<std::array<std::size_t, 4>> merges;
+
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const std::pmr::vector<Position>& g_list = order[i]->get_g_list();
+        std::size_t cursor = offset[i];
+        std::size_t next = 0; // primo elemento della g-list non ancora scritto
+
+        for (std::size_t c = 0; c < order[i]->get_children().size(); ++c) {
+            const std::size_t child = first_child[i] + c;
+            std::size_t h = order[child]->get_insertion_target();
+            std::size_t overlap = order[child]->get_overlap();
+            cursor = std::copy(g_list.begin() + next, g_list.begin() + h, sa.begin() + cursor) - sa.begin();
+            cursor = std::copy(g_list.begin() + h, g_list.begin() + h + overlap, sa.begin() + cursor) - sa.begin();
+            offset[child] = cursor;
+            if (overlap > 0) {
+                merges.push_back({cursor - overlap, cursor, cursor + subtree_size[child],
+                                  order[child]->get_suffix().size()});
+            }
+            cursor += subtree_size[child];
+            next = h + overlap;
+        }
+        std::copy(g_list.begin() + next, g_list.end(), sa.begin() + cursor);
+    }
 
+    // I blocchi dei discendenti sono registrati dopo quelli degli antenati: si fondono in ordine inverso.
+    std::string_view text = root->get_text();
+    for (auto it = merges.rbegin(); it != merges.rend(); ++it) {
+        merge_overlap(sa.begin() + (*it)[0], sa.begin() + (*it)[1], sa.begin() + (*it)[2], text, (*it)[3]);
+    }
 
+    LOGC(log_enabled(Verbosity::phases)) << "suffix array assembled: " << sa.size() << " positions, "
+                                         << order.size() << " nodes, " << merges.size() << " merges";
+    return sa;
+}
 
+/**
+ * @brief Calcola il rango inverso rank[sa[i]] = i e controlla che sa sia una permutazione di [0, n).
+ *
+ * Nella prima passata scrive il rango inverso e nella seconda controlla che rank[sa[i]] == i per ogni i:
+ * insieme al controllo dell'intervallo, questo garantisce che sa sia una permutazione (due indici con la
+ * stessa posizione non possono rileggere entrambi il proprio rango). Entrambe le passate dividono sa tra i thread.
+ *
+ * @tparam Rank Tipo dei ranghi, capace di rappresentare n.
+ * @tparam Position Tipo delle posizioni.
+ * @param sa Array da verificare, di n posizioni.
+ * @param rank Array di n ranghi, riempito con il rango inverso.
+ * @param pool Thread pool, nullptr per l'esecuzione sequenziale.
+ * @return true se sa e' una permutazione di [0, n).
+ */
+template <typename Rank, typename Position>
+bool invert_permutation(std::span<const Position> sa, Rank* rank, tlx::ThreadPool* pool) {
+    const std::size_t n = sa.size();
+    std::atomic<bool> valid = true;
+
+    // Con posizioni ripetute piu' thread possono scrivere lo stesso rango: le scritture sono atomiche.
+    parallel_for(pool, n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            uint64_t position = sa[i];
+            if (position >= n) {
+                valid.store(false, std::memory_order_relaxed);
+                return;
+            }
+            std::atomic_ref<Rank>(rank[position]).store(static_cast<Rank>(i), std::memory_order_relaxed);
+        }
+    });
+    if (!valid) {
+        return false;
+    }
+    parallel_for(pool, n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (std::atomic_ref<Rank>(rank[static_cast<uint64_t>(sa[i])]).load(std::memory_order_relaxed) != i) {
+                valid.store(false, std::memory_order_relaxed);
+                return;
+            }
+        }
+    });
+    return valid;
+}
 
+/**
+ * @brief Verifica che sa sia il suffix array di text, in tempo O(n) e in parallelo.
+ *
+ * Le prime due passate calcolano il rango inverso e controllano che sa sia una permutazione
+ * (invert_permutation()). La terza confronta ogni coppia di suffissi adiacenti a = sa[i - 1], b = sa[i] con
+ * un solo carattere: se text[a] < text[b] l'ordine e' corretto, se sono uguali deve valere rank[a + 1] < rank[b + 1], dove il
+ * suffisso vuoto (a + 1 = n) precede tutti gli altri. Non si confrontano mai i prefissi comuni, quindi il
+ * costo non dipende dalla ripetitivita' del testo. Le tre passate dividono sa tra i thread.
+ *
+ * @tparam Position Tipo delle posizioni.
+ * @param text Testo.
+ * @param sa Suffix array da verificare (ad esempio la g-list della radice dopo build_list).
+ * @param threads Numero di thread da utilizzare.
+ * @return true se sa e' il suffix array di text.
+ */
+template <typename Position>
+bool is_suffix_array(std::string_view text, std::span<const Position> sa, unsigned int threads = 1) {
+    using Rank = std::conditional_t<sizeof(Position) <= sizeof(uint32_t), uint32_t, uint64_t>;
+    const std::size_t n = text.size();
+    if (sa.size() != n) {
+        return false;
+    }
+    std::unique_ptr<tlx::ThreadPool> pool;
+    if (threads > 1) {
+        pool = std::make_unique<tlx::ThreadPool>(threads);
+    }
+    std::unique_ptr<Rank[]> rank(new Rank[n]);
+    if (!invert_permutation(sa, rank.get(), pool.get())) {
+        return false;
+    }
+    std::atomic<bool> valid = true;
+
+    const unsigned char* symbols = reinterpret_cast<const unsigned char*>(text.data());
+    parallel_for(pool.get(), n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = std::max<std::size_t>(begin, 1); i < end; ++i) {
+            uint64_t a = sa[i - 1];
+            uint64_t b = sa[i];
+            if (symbols[a] > symbols[b]) {
+                valid.store(false, std::memory_order_relaxed);
+                return;
+            }
+            if (symbols[a] == symbols[b]) {
+                // Il suffisso vuoto e' il minimo: b + 1 = n rende b < a.
+                if (b + 1 == n || (a + 1 < n && rank[a + 1] > rank[b + 1])) {
+                    valid.store(false, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+    });
+    return valid;
+}
+
+/**
+ * @brief Verifica che gsa sia il suffix array generalizzato di una collezione, in tempo O(n) e in parallelo.
+ *
+ * Procede come is_suffix_array() sulle posizioni della concatenazione, ma il carattere che segue l'ultimo
+ * di un documento d e' il separatore $_d: se a e b hanno lo stesso carattere e b e' l'ultimo del proprio
+ * documento, a deve esserlo a sua volta e appartenere a un documento precedente; se lo e' solo a, l'ordine
+ * e' corretto; altrimenti deve valere rank[a + 1] < rank[b + 1].
+ *
+ * @tparam Position Tipo delle posizioni.
+ * @param collection Collezione.
+ * @param gsa Suffix array generalizzato da verificare, come posizioni della concatenazione.
+ * @param threads Numero di thread da utilizzare.
+ * @return true se gsa e' il suffix array generalizzato della collezione.
+ */
+template <typename Position>
+bool is_generalized_suffix_array(const Collection& collection, std::span<const Position> gsa, unsigned int threads = 1) {
+    using Rank = std::conditional_t<sizeof(Position) <= sizeof(uint32_t), uint32_t, uint64_t>;
+    std::string_view text = collection.text();
+    const std::size_t n = text.size();
+    if (gsa.size() != n) {
+        return false;
+    }
+    std::unique_ptr<tlx::ThreadPool> pool;
+    if (threads > 1) {
+        pool = std::make_unique<tlx::ThreadPool>(threads);
+    }
+    std::unique_ptr<Rank[]> rank(new Rank[n]);
+    if (!invert_permutation(gsa, rank.get(), pool.get())) {
+        return false;
+    }
+    std::atomic<bool> valid = true;
+
+    // last[p] indica che p e' l'ultimo carattere del proprio documento.
+    pasta::BitVector last(n, 0);
+    for (std::size_t d = 0; d < collection.size(); ++d) {
+        if (collection.end(d) > collection.start(d)) {
+            last[collection.end(d) - 1] = 1;
+        }
+    }
+
+    const unsigned char* symbols = reinterpret_cast<const unsigned char*>(text.data());
+    parallel_for(pool.get(), n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = std::max<std::size_t>(begin, 1); i < end; ++i) {
+            uint64_t a = gsa[i - 1];
+            uint64_t b = gsa[i];
+            if (symbols[a] > symbols[b]) {
+                valid.store(false, std::memory_order_relaxed);
+                return;
+            }
+            if (symbols[a] == symbols[b]) {
+                bool ordered = last[b] ? last[a] && collection.document_of(a) < collection.document_of(b)
+                                       : last[a] || rank[a + 1] < rank[b + 1];
+                if (!ordered) {
+                    valid.store(false, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+    });
+    return valid;
+}
+
+/**
+ * @brief Calcola l'array LCP di un suffix array: lcp[i] e' la lunghezza del prefisso comune tra i suffissi
+ * sa[i - 1] e sa[i], con lcp[0] = 0.
+ *
+ * Usa la variante di Kasai con l'array Phi (Kaerkkaeinen, Manzini e Puglisi, 2009): phi[sa[i]] = sa[i - 1]
+ * associa a ogni suffisso il precedente in ordine lessicografico; scorrendo il testo da sinistra a destra
+ * il prefisso comune plcp[j] = lcp(j, phi[j]) diminuisce al piu' di uno da j a j + 1, quindi i confronti
+ * tra caratteri sono O(n) in totale. plcp sovrascrive phi nello stesso array e viene infine permutato in
+ * ordine di suffix array. Il testo e' diviso in intervalli tra i thread: ognuno riparte da un prefisso
+ * comune nullo al proprio inizio, con un costo aggiuntivo pari al plcp dei punti di divisione.
+ *
+ * @tparam Position Tipo delle posizioni, usato anche per i valori LCP (minori di n).
+ * @param text Testo.
+ * @param sa Suffix array del testo.
+ * @param threads Numero di thread da utilizzare.
+ * @return L'array LCP.
+ */
+template <typename Position>
+std::vector<Position> build_lcp_array(std::string_view text, std::span<const Position> sa, unsigned int threads = 1) {
+    using Index = std::conditional_t<sizeof(Position) <= sizeof(uint32_t), uint32_t, uint64_t>;
+    const std::size_t n = sa.size();
+    std::vector<Position> lcp(n);
+    if (n == 0) {
+        return lcp;
+    }
+    std::unique_ptr<tlx::ThreadPool> pool;
+    if (threads > 1) {
+        pool = std::make_unique<tlx::ThreadPool>(threads);
+    }
+
+    // Il primo suffisso non ha predecessore: n indica l'assenza.
+    std::unique_ptr<Index[]> phi(new Index[n]);
+    parallel_for(pool.get(), n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            phi[static_cast<uint64_t>(sa[i])] = i > 0 ? static_cast<Index>(sa[i - 1]) : static_cast<Index>(n);
+        }
+    });
+
+    parallel_for(pool.get(), n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::size_t h = 0;
+        for (std::size_t j = begin; j < end; ++j) {
+            std::size_t previous = phi[j];
+            if (previous == n) {
+                h = 0;
+            } else {
+                while (j + h < n && previous + h < n && text[j + h] == text[previous + h]) {
+                    ++h;
+                }
+            }
+            phi[j] = static_cast<Index>(h);
+            h -= h > 0;
+        }
+    });
+
+    parallel_for(pool.get(), n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            lcp[i] = phi[static_cast<uint64_t>(sa[i])];
+        }
+    });
+    return lcp;
+}
+
+/**
+ * @brief Stima per difetto la memoria necessaria per costruire il suffix array di una fattorizzazione.
+ *
+ * Ogni occorrenza di un suffisso locale compare nella g-list di un solo nodo e nell'insieme delle sue
+ * occorrenze: le g-list occupano quindi n posizioni e gli insiemi almeno n indici di fattore, a cui si
+ * aggiungono il suffix array, il testo e gli offset e i fingerprint dei fattori. Non sono contati i nodi,
+ * il cui numero dipende dal testo: la stima serve a scartare in anticipo le esecuzioni che certamente non rientrano in un limite di memoria.
+ *
+ * @tparam Position Tipo delle posizioni.
+ * @param icfl_t Fattorizzazione.
+ * @return Numero minimo di byte richiesti dalla costruzione.
+ */
+template <typename Position>
+uint64_t estimate_construction_memory(const Factorization& icfl_t) {
+    const uint64_t n = icfl_t.text().size();
+    const uint64_t k = icfl_t.size();
+    return n                                 // testo
+           + 2 * n * sizeof(Position)        // g-list e suffix array
+           + n * sizeof(uint32_t)            // insiemi delle occorrenze
+           + k * (sizeof(uint64_t) * 2);     // offset e fingerprint dei fattori
+}
+
+/**
+ * @brief Algoritmo di costruzione del suffix array.
+ */
+enum class SuffixArrayEngine {
+    automatic, ///< Scelto da choose_engine() in base alla fattorizzazione.
+    prefix_tree, ///< Prefix tree dei suffissi locali (build_tree e build_suffix_array).
+    sais ///< SA-IS sul testo, senza usare la fattorizzazione (sais.hpp).
+};
+
+/**
+ * @brief Interpreta il nome di un algoritmo di costruzione.
+ * @param name Nome: auto, tree o sais.
+ * @return L'algoritmo corrispondente.
+ * @throw std::invalid_argument Se il nome non e' riconosciuto.
+ */
+inline SuffixArrayEngine parse_engine(const std::string& name) {
+    if (name == "auto") {
+        return SuffixArrayEngine::automatic;
+    }
+    if (name == "tree") {
+        return SuffixArrayEngine::prefix_tree;
+    }
+    if (name == "sais") {
+        return SuffixArrayEngine::sais;
+    }
+    throw std::invalid_argument("Unknown engine: " + name);
+}
+
+/**
+ * @brief Restituisce il nome di un algoritmo di costruzione, come accettato da parse_engine().
+ * @param engine Algoritmo.
+ * @return Il nome dell'algoritmo.
+ */
+inline std::string engine_name(SuffixArrayEngine engine) {
+    switch (engine) {
+        case SuffixArrayEngine::prefix_tree: return "tree";
+        case SuffixArrayEngine::sais: return "sais";
+        default: return "auto";
+    }
+}
+
+/**
+ * Rapporto massimo tra il lavoro stimato del prefix tree e la lunghezza del testo oltre il quale
+ * choose_engine() preferisce SA-IS.
+ */
+constexpr double PREFIX_TREE_WORK_RATIO = 32.0;
+
+/**
+ * @brief Stima il lavoro della costruzione con il prefix tree, in unita' confrontabili con la lunghezza del testo.
+ *
+ * Ogni suffisso locale di lunghezza l viene esteso, cercato nell'albero e confrontato carattere per
+ * carattere, quindi un fattore di lunghezza l costa circa l^2; gli insiemi delle occorrenze e la ricerca
+ * degli insertion target aggiungono un termine proporzionale a k^2. Sulle serie di bench -g factors e sui
+ * testi casuali il tempo di build_tree segue (k^2 + somma di l^2) con una costante vicina a quella di SA-IS
+ * per carattere.
+ *
+ * @param icfl_t Fattorizzazione.
+ * @return Lavoro stimato (k^2 + somma dei quadrati delle lunghezze dei fattori).
+ */
+inline double estimate_prefix_tree_work(const Factorization& icfl_t) {
+    const double k = icfl_t.size();
+    double work = k * k;
+    for (std::size_t i = 0; i < icfl_t.size(); ++i) {
+        const double length = icfl_t.length(i);
+        work += length * length;
+    }
+    return work;
+}
+
+/**
+ * @brief Sceglie l'algoritmo di costruzione in base alle statistiche dei fattori.
+ *
+ * Il prefix tree e' usato finche' il suo lavoro stimato resta entro PREFIX_TREE_WORK_RATIO volte la
+ * lunghezza del testo, cioe' con molti fattori corti; con pochi fattori molto lunghi (tipicamente testi
+ * casuali o periodici) l'albero diventa troppo grande e si ripiega su SA-IS.
+ *
+ * @param icfl_t Fattorizzazione.
+ * @return SuffixArrayEngine::prefix_tree oppure SuffixArrayEngine::sais.
+ */
+inline SuffixArrayEngine choose_engine(const Factorization& icfl_t) {
+    const double n = icfl_t.text().size();
+    return estimate_prefix_tree_work(icfl_t) <= PREFIX_TREE_WORK_RATIO * n ? SuffixArrayEngine::prefix_tree
+                                                                           : SuffixArrayEngine::sais;
+}
+
+/**
+ * @brief Sceglie l'algoritmo di costruzione del suffix array generalizzato di una collezione.
+ *
+ * Con il prefix tree ogni documento ha il proprio albero, quindi il lavoro stimato e' la somma di quello
+ * dei documenti (k_d^2 + somma di l^2 sui loro fattori), piu' n log2 D per la fusione dei loro suffix array.
+ * La soglia e' quella di choose_engine(), a cui la scelta si riduce con un solo documento.
+ *
+ * @param collection Collezione.
+ * @param icfl_t Fattorizzazione della concatenazione, con la ICFL di ogni documento (factorize_collection()).
+ * @return SuffixArrayEngine::prefix_tree oppure SuffixArrayEngine::sais.
+ */
+inline SuffixArrayEngine choose_engine(const Collection& collection, const Factorization& icfl_t) {
+    const double n = icfl_t.text().size();
+    double work = n * std::log2(std::max<double>(collection.size(), 1));
+    double k = 0; // fattori del documento corrente
+    for (std::size_t i = 0, d = 0; i < icfl_t.size(); ++i) {
+        while (icfl_t.start(i) >= collection.end(d)) {
+            work += k * k;
+            k = 0;
+            ++d;
+        }
+        const double length = icfl_t.length(i);
+        work += length * length;
+        ++k;
+    }
+    work += k * k;
+    return work <= PREFIX_TREE_WORK_RATIO * n ? SuffixArrayEngine::prefix_tree : SuffixArrayEngine::sais;
+}
+
+/**
+ * @brief Costruisce il suffix array di una fattorizzazione con l'algoritmo indicato.
+ *
+ * Con il prefix tree equivale a build_tree() seguito da build_suffix_array(); con SA-IS la
+ * fattorizzazione non viene usata. I due algoritmi producono lo stesso suffix array.
+ *
+ * @tparam Position Tipo delle posizioni nel testo.
+ * @param icfl_t Fattorizzazione ICFL del testo.
+ * @param engine Algoritmo; con SuffixArrayEngine::automatic viene scelto da choose_engine().
+ * @param threads Numero di thread per build_tree (SA-IS e' sequenziale).
+ * @return Il suffix array del testo.
+ * @throw std::invalid_argument Se Position non puo' rappresentare le posizioni del testo.
+ */
+template <typename Position = uint32_t>
+std::vector<Position> construct_suffix_array(Factorization icfl_t,
+                                             SuffixArrayEngine engine = SuffixArrayEngine::automatic,
+                                             unsigned int threads = 1) {
+    if (engine == SuffixArrayEngine::automatic) {
+        engine = choose_engine(icfl_t);
+    }
+    if (engine == SuffixArrayEngine::sais) {
+        if (icfl_t.text().size() > max_position<Position>()) {
+            throw std::invalid_argument("Text too long for the position type");
+        }
+        return build_suffix_array_sais<Position>(icfl_t.text());
+    }
+    BasicTree<Position> tree = build_tree<Position>(std::move(icfl_t), threads);
+    return build_suffix_array(tree.get_root());
+}
+
+/**
+ * @brief Calcola con SA-IS il suffix array generalizzato di una collezione.
+ *
+ * I documenti sono concatenati con i separatori in una sequenza di interi: il separatore del documento d e'
+ * il simbolo d e il carattere c diventa D + c, dove D e' il numero di documenti. I separatori sono quindi
+ * distinti, minori di ogni carattere e ordinati per documento, e i loro suffissi occupano le prime D voci
+ * del suffix array della sequenza; le restanti sono il suffix array generalizzato. Dopo SA-IS la sequenza
+ * viene riusata per convertire le posizioni in posizioni della concatenazione senza separatori.
+ *
+ * @tparam Position Tipo delle posizioni restituite.
+ * @tparam Index Tipo degli indici di SA-IS, capace di rappresentare n + D.
+ * @param collection Collezione.
+ * @return Il suffix array generalizzato, come posizioni della concatenazione.
+ */
+template <typename Position, typename Index>
+std::vector<Position> build_generalized_suffix_array_sais(const Collection& collection) {
+    const std::size_t documents = collection.size();
+    std::string_view text = collection.text();
+    std::vector<Index> sequence(text.size() + documents);
+    std::size_t cursor = 0;
+    for (std::size_t d = 0; d < documents; ++d) {
+        for (uint64_t p = collection.start(d); p < collection.end(d); ++p) {
+            sequence[cursor++] = static_cast<Index>(documents + static_cast<unsigned char>(text[p]));
+        }
+        sequence[cursor++] = static_cast<Index>(d);
+    }
+    std::vector<Index> sa = sais<Index, Index>(sequence, static_cast<Index>(documents + UCHAR_MAX));
+
+    // Il carattere in posizione q della sequenza, nel documento d, e' in posizione q - d nella concatenazione.
+    cursor = 0;
+    for (std::size_t d = 0; d < documents; ++d) {
+        for (uint64_t p = collection.start(d); p < collection.end(d); ++p) {
+            sequence[cursor++] = static_cast<Index>(p);
+        }
+        ++cursor;
+    }
+    std::vector<Position> gsa(text.size());
+    for (std::size_t i = 0; i < gsa.size(); ++i) {
+        gsa[i] = sequence[sa[documents + i]];
+    }
+    return gsa;
+}
+
+/**
+ * @brief Costruisce il suffix array generalizzato di una collezione di documenti.
+ *
+ * Ogni documento d e' seguito da un separatore $_d, minore di ogni carattere, con $_0 < $_1 < ...: un
+ * suffisso termina alla fine del proprio documento e, tra due suffissi uguali, precede quello del documento
+ * con indice minore. Con SA-IS la collezione viene ordinata in un'unica passata sulla sequenza con i
+ * separatori (build_generalized_suffix_array_sais()). Con il prefix tree il suffix array di ogni documento
+ * viene costruito con construct_suffix_array() dall'intervallo dei suoi fattori (Factorization::slice(),
+ * senza copiare il testo), in parallelo tra i documenti; i suffix array dei documenti vengono poi fusi con
+ * un loser tree LCP-aware, guidato dagli array LCP dei documenti (build_lcp_array()). Con
+ * SuffixArrayEngine::automatic l'algoritmo e' scelto da choose_engine(collection, factors).
+ *
+ * Non viene costruito un unico albero della collezione: l'albero ordina i suffissi locali tramite le
+ * prosecuzioni nei fattori successivi (getInsertionTarget()), che con i separatori dovrebbero fermarsi al
+ * confine del documento ed essere confrontate con un alfabeto esteso in ogni passo della costruzione. Gli
+ * alberi per documento evitano queste modifiche, al prezzo della fusione: O(n log D) confronti per D
+ * documenti, oltre alla costruzione degli array LCP. Su collezioni di read corte la fusione domina e
+ * choose_engine() sceglie SA-IS.
+ *
+ * @tparam Position Tipo delle posizioni e degli indici dei documenti.
+ * @param collection Collezione.
+ * @param factors Fattorizzazione della concatenazione in cui nessun fattore attraversa il confine di un
+ *        documento (factorize_collection()).
+ * @param engine Algoritmo di costruzione.
+ * @param threads Numero di thread (per documento con un solo documento, altrimenti tra i documenti).
+ * @return Il suffix array generalizzato, come posizioni della concatenazione (vedi Collection::locate()).
+ * @throw std::invalid_argument Se Position non puo' rappresentare le posizioni o i documenti, o se la
+ *        fattorizzazione non rispetta i confini dei documenti.
+ */
+template <typename Position = uint32_t>
+std::vector<Position> build_generalized_suffix_array(const Collection& collection, const Factorization& factors,
+                                                     SuffixArrayEngine engine = SuffixArrayEngine::automatic,
+                                                     unsigned int threads = 1) {
+    std::string_view text = collection.text();
+    const std::size_t documents = collection.size();
+    if (text.size() > max_position<Position>() || documents > max_position<Position>()) {
+        throw std::invalid_argument("Collection too large for the position type");
+    }
+    if (factors.text().size() != text.size()) {
+        throw std::invalid_argument("Factorization and collection lengths differ");
+    }
+    if (engine == SuffixArrayEngine::automatic) {
+        engine = choose_engine(collection, factors);
+    }
+    if (documents == 1) {
+        return construct_suffix_array<Position>(factors.slice(0, factors.size()), engine, threads);
+    }
+    if (engine != SuffixArrayEngine::prefix_tree) {
+        if (text.size() + documents < std::numeric_limits<uint32_t>::max()) {
+            return build_generalized_suffix_array_sais<Position, uint32_t>(collection);
+        }
+        return build_generalized_suffix_array_sais<Position, uint64_t>(collection);
+    }
 
+    // I fattori del documento d sono [first[d], first[d + 1]).
+    const std::vector<uint64_t>& starts = factors.starts();
+    std::vector<std::size_t> first(documents + 1);
+    for (std::size_t d = 0; d <= documents; ++d) {
+        uint64_t start = d < documents ? collection.start(d) : text.size();
+        first[d] = std::lower_bound(starts.begin(), starts.end() - 1, start) - starts.begin();
+        if (d < documents && collection.end(d) > start && (first[d] == factors.size() || starts[first[d]] != start)) {
+            throw std::invalid_argument("A factor crosses a document boundary");
+        }
+    }
 
+    std::unique_ptr<tlx::ThreadPool> pool;
+    if (threads > 1) {
+        pool = std::make_unique<tlx::ThreadPool>(threads);
+    }
+    // Il suffix array di ogni documento occupa l'intervallo del documento, in posizioni della concatenazione,
+    // e il suo array LCP lo stesso intervallo di lcp.
+    std::vector<Position> local(text.size()), lcp(text.size());
+    parallel_for(pool.get(), documents, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t d = begin; d < end; ++d) {
+            if (first[d] == first[d + 1]) {
+                continue;
+            }
+            std::vector<Position> sa = construct_suffix_array<Position>(factors.slice(first[d], first[d + 1]),
+                                                                        SuffixArrayEngine::prefix_tree);
+            std::vector<Position> document_lcp = build_lcp_array<Position>(collection.document(d), sa);
+            for (std::size_t i = 0; i < sa.size(); ++i) {
+                local[collection.start(d) + i] = collection.start(d) + static_cast<uint64_t>(sa[i]);
+                lcp[collection.start(d) + i] = document_lcp[i];
+            }
+        }
+    });
+
+    // Fusione LCP-aware con un loser tree sui documenti non vuoti (Bingmann, Eberle e Sanders): l'altezza di un
+    // candidato e' il prefisso comune con un suffisso gia' emesso, lo stesso per i due candidati di ogni
+    // confronto. Con altezze diverse precede il candidato con l'altezza maggiore; con altezze uguali decidono i
+    // caratteri memorizzati in quella posizione e solo se coincidono il confronto prosegue sul testo. L'altezza
+    // del successore nel flusso del vincitore e' il valore dell'array LCP del suo documento.
+    struct Stream {
+        uint64_t cursor; ///< Indice in local del candidato.
+        uint64_t limit; ///< Fine del documento nella concatenazione.
+        uint64_t height; ///< Prefisso comune con il riferimento.
+        uint16_t key; ///< Carattere del candidato in posizione height, piu' uno; 0 per il separatore.
+    };
+    std::vector<Stream> streams; // in ordine di documento
+    for (std::size_t d = 0; d < documents; ++d) {
+        if (collection.end(d) > collection.start(d)) {
+            streams.push_back({collection.start(d), collection.end(d), 0, 0});
+        }
+    }
+    auto key_at = [&](const Stream& stream, uint64_t h) -> uint16_t {
+        const uint64_t p = local[stream.cursor] + h;
+        return p < stream.limit ? 1 + static_cast<unsigned char>(text[p]) : 0;
+    };
+    for (Stream& stream : streams) {
+        stream.key = key_at(stream, 0);
+    }
+    std::size_t leaves = 1;
+    while (leaves < streams.size()) {
+        leaves *= 2;
+    }
+    streams.resize(leaves, {0, 0, 0, 0}); // flussi vuoti fino a una potenza di due
+
+    // Restituisce (vincitore, perdente) e aggiorna altezza e carattere del perdente rispetto al vincitore.
+    auto play = [&](std::size_t a, std::size_t b) -> std::pair<std::size_t, std::size_t> {
+        Stream& x = streams[a];
+        Stream& y = streams[b];
+        if (x.cursor == x.limit || y.cursor == y.limit) {
+            return x.cursor == x.limit ? std::make_pair(b, a) : std::make_pair(a, b);
+        }
+        if (x.height != y.height) {
+            return x.height > y.height ? std::make_pair(a, b) : std::make_pair(b, a);
+        }
+        uint16_t kx = x.key, ky = y.key;
+        uint64_t h = x.height;
+        while (kx == ky && kx != 0) {
+            ++h;
+            kx = key_at(x, h);
+            ky = key_at(y, h);
+        }
+        // A parita' di carattere sono entrambi separatori: precede il documento minore.
+        const bool first = kx < ky || (kx == ky && a < b);
+        Stream& beaten = first ? y : x;
+        beaten.height = h;
+        beaten.key = first ? ky : kx;
+        return first ? std::make_pair(a, b) : std::make_pair(b, a);
+    };
+
+    std::vector<std::size_t> loser(leaves), winner(2 * leaves);
+    for (std::size_t i = 0; i < leaves; ++i) {
+        winner[leaves + i] = i;
+    }
+    for (std::size_t node = leaves - 1; node > 0; --node) {
+        std::tie(winner[node], loser[node]) = play(winner[2 * node], winner[2 * node + 1]);
+    }
+    std::vector<Position> gsa;
+    gsa.reserve(text.size());
+    for (std::size_t w = winner[1]; streams[w].cursor < streams[w].limit; ) {
+        Stream& stream = streams[w];
+        gsa.push_back(local[stream.cursor]);
+        if (++stream.cursor < stream.limit) {
+            stream.height = lcp[stream.cursor];
+            stream.key = key_at(stream, stream.height);
+        }
+        for (std::size_t node = (leaves + w) / 2; node > 0; node /= 2) {
+            std::tie(w, loser[node]) = play(w, loser[node]);
+        }
+    }
+    return gsa;
+}
 
+/**
+ * @brief Converte un suffix array generalizzato nelle coppie (documento, offset).
+ * @tparam Position Tipo delle posizioni.
+ * @param collection Collezione.
+ * @param gsa Suffix array generalizzato, come posizioni della concatenazione.
+ * @return Le coppie (documento, offset), nello stesso ordine.
+ */
+template <typename Position>
+std::vector<DocumentSuffix<Position>> to_document_suffixes(const Collection& collection, std::span<const Position> gsa) {
+    std::vector<DocumentSuffix<Position>> suffixes;
+    suffixes.reserve(gsa.size());
+    for (Position position : gsa) {
+        suffixes.push_back(collection.locate<Position>(position));
+    }
+    return suffixes;
+}
 
+/**
+ * @brief Costruisce l'albero direttamente dal testo, calcolandone la ICFL.
+ * @tparam Position Tipo delle posizioni nel testo.
+ * @param text Il testo di cui costruire il prefix-tree.
+ * @param threads Numero di thread da utilizzare (1 per la costruzione sequenziale).
+ * @return L'albero costruito.
+ *
+ * La fattorizzazione viene calcolata in tempo lineare da compute_ICFL(), senza passare da un file
+ * di fattori prodotto esternamente.
+ */
+template <typename Position = uint32_t>
+BasicTree<Position> build_tree(const std::string& text, unsigned int threads = 1) {
+    return build_tree<Position>(factorize_ICFL(text), threads);
+}
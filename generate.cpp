@@ -0,0 +1,78 @@
+/**
+ * @file generate.cpp
+ * @brief Generatore di testi sintetici: scrive il testo grezzo e/o la sua ICFL nel formato di input.txt.
+ */
+
+#include "func.hpp"
+#include "generator.hpp"
+
+#include <tlx/cmdline_parser.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    GeneratorOptions options;
+    uint64_t length = options.length;
+    std::string text_output;
+    std::string factor_output;
+
+    tlx::CmdlineParser cp;
+    cp.set_description("Generates synthetic texts with controlled properties, as raw text and/or factor file.");
+    cp.add_param_string("model", options.model, "Model: fibonacci, random, dna, bytes, periodic or factors");
+    cp.add_param_bytes("length", length, "Text length, e.g. 1M");
+    cp.add_string('o', "text", text_output, "Raw text output file");
+    cp.add_string('i', "icfl", factor_output, "Factor file output (number of factors, then one factor per line)");
+    cp.add_uint('s', "sigma", options.sigma, "Alphabet size, 1 to 26 (default: 4)");
+    cp.add_size_t('p', "period", options.period, "Period of the periodic model (default: 16)");
+    cp.add_double('m', "mutation", options.mutation, "Mutation rate of the periodic model (default: 0)");
+    cp.add_size_t('k', "factors", options.factors, "Expected number of factors of the factors model (default: 10)");
+    cp.add_string('d', "distribution", options.distribution,
+                  "Factor length distribution: fixed, uniform or geometric (default: uniform)");
+    cp.add_size_t('S', "seed", options.seed, "Seed of the pseudorandom generator (default: 42)");
+
+    if (!cp.process(argc, argv)) {
+        return 1;
+    }
+
+    try {
+        if (text_output.empty() && factor_output.empty()) {
+            throw std::invalid_argument("Nothing to write: use --text and/or --icfl");
+        }
+        options.length = length;
+        std::string text = generate_text(options);
+
+        if (!text_output.empty()) {
+            std::ofstream file(text_output, std::ios::binary | std::ios::trunc);
+            file.write(text.data(), text.size());
+            if (!file) {
+                throw std::runtime_error("Error writing file: " + text_output);
+            }
+        }
+
+        Factorization factors = factorize_ICFL(std::move(text));
+        if (!factor_output.empty()) {
+            write_factor_file(factor_output, factors);
+        }
+
+        uint64_t longest = 0;
+        uint64_t shortest = factors.size() > 0 ? factors.length(0) : 0;
+        for (std::size_t i = 0; i < factors.size(); ++i) {
+            longest = std::max(longest, factors.length(i));
+            shortest = std::min(shortest, factors.length(i));
+        }
+        std::cout << "GENERATED model=" << options.model << " n=" << factors.text().size()
+                  << " sigma=" << options.sigma << " seed=" << options.seed << " k=" << factors.size()
+                  << " min_factor=" << shortest << " max_factor=" << longest
+                  << " mean_factor=" << (factors.size() > 0 ? double(factors.text().size()) / factors.size() : 0.0)
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "generate: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
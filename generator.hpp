@@ -0,0 +1,208 @@
+#ifndef ICFL_GENERATOR_HPP
+#define ICFL_GENERATOR_HPP
+
+/**
+ * @file generator.hpp
+ * @brief Generatori di testi sintetici con proprieta' controllate, per gli esperimenti di scalabilita'.
+ *
+ * I testi usano le prime sigma lettere minuscole dell'alfabeto, tranne il modello bytes. I modelli
+ * disponibili sono:
+ * - fibonacci: parola di Fibonacci su {a, b}, massimamente ripetitiva;
+ * - random: caratteri indipendenti e uniformi (con sigma = 4 e alfabeto acgt: DNA casuale);
+ * - dna: caratteri uniformi su {a, c, g, t};
+ * - bytes: caratteri uniformi su tutti i 256 valori di byte (sigma viene ignorato), per provare gli indici
+ *   sull'alfabeto completo;
+ * - periodic: ripetizioni di un periodo casuale, con una frazione di caratteri mutati;
+ * - factors: concatenazione di blocchi crescenti che iniziano con la lettera massima, seguita da lettere
+ *   minori, con lunghezze estratte da una distribuzione (fissa, uniforme o geometrica). I blocchi sono
+ *   parole di Lyndon inverse e la ICFL del testo li segue: numero e lunghezze dei fattori sono controllati
+ *   (a meno dell'ultimo blocco, troncato).
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Parametri di generazione di un testo.
+ */
+struct GeneratorOptions {
+    std::string model = "random"; ///< Modello: fibonacci, random, dna, bytes, periodic o factors.
+    std::size_t length = 1000; ///< Lunghezza del testo.
+    unsigned int sigma = 4; ///< Dimensione dell'alfabeto (da 1 a 26; almeno 3 per factors).
+    std::size_t period = 16; ///< Lunghezza del periodo (modello periodic).
+    double mutation = 0.0; ///< Probabilita' di mutare ogni carattere (modello periodic).
+    std::size_t factors = 10; ///< Numero atteso di blocchi (modello factors).
+    std::string distribution = "uniform"; ///< Distribuzione delle lunghezze dei blocchi: fixed, uniform o geometric.
+    uint64_t seed = 42; ///< Seme del generatore pseudocasuale.
+};
+
+/**
+ * @brief Genera il prefisso di lunghezza n della parola di Fibonacci (limite di f_1 = b, f_2 = a, f_k = f_{k-1} f_{k-2}).
+ * @param n Lunghezza del testo.
+ * @return Il testo generato.
+ */
+inline std::string generate_fibonacci(std::size_t n) {
+    std::string previous = "b", current = "a";
+    while (current.size() < n) {
+        std::string next = current + previous;
+        previous = std::move(current);
+        current = std::move(next);
+    }
+    current.resize(n);
+    return current;
+}
+
+/**
+ * @brief Genera un testo di caratteri indipendenti e uniformi su un alfabeto.
+ * @param n Lunghezza del testo.
+ * @param alphabet Caratteri dell'alfabeto.
+ * @param random Generatore pseudocasuale.
+ * @return Il testo generato.
+ */
+inline std::string generate_uniform(std::size_t n, const std::string& alphabet, std::mt19937_64& random) {
+    std::uniform_int_distribution<std::size_t> letter(0, alphabet.size() - 1);
+    std::string text(n, '\0');
+    for (char& c : text) {
+        c = alphabet[letter(random)];
+    }
+    return text;
+}
+
+/**
+ * @brief Genera un testo periodico: un periodo casuale ripetuto, con caratteri mutati a caso.
+ * @param n Lunghezza del testo.
+ * @param period Lunghezza del periodo.
+ * @param alphabet Caratteri dell'alfabeto.
+ * @param mutation Probabilita' che un carattere venga sostituito da uno casuale.
+ * @param random Generatore pseudocasuale.
+ * @return Il testo generato.
+ */
+inline std::string generate_periodic(std::size_t n, std::size_t period, const std::string& alphabet,
+                                     double mutation, std::mt19937_64& random) {
+    std::string base = generate_uniform(period, alphabet, random);
+    std::uniform_int_distribution<std::size_t> letter(0, alphabet.size() - 1);
+    std::bernoulli_distribution mutate(mutation);
+    std::string text(n, '\0');
+    for (std::size_t i = 0; i < n; ++i) {
+        text[i] = mutation > 0 && mutate(random) ? alphabet[letter(random)] : base[i % period];
+    }
+    return text;
+}
+
+/**
+ * @brief Genera una concatenazione di blocchi, ognuno formato dalla lettera massima seguita da lettere minori.
+ *
+ * Dopo la lettera massima ogni blocco contiene il proprio indice, scritto in base sigma - 1 con le lettere
+ * minori e con un numero fisso di cifre, seguito da lettere minori casuali. Ogni blocco e' quindi una parola
+ * di Lyndon inversa e ogni blocco e' minore del successivo in un carattere che non e' l'ultimo
+ * (x << y): i blocchi formano una fattorizzazione di Lyndon inversa del testo.
+ * Le lunghezze dei blocchi hanno media n / factors, con un minimo pari alla lunghezza dell'indice piu' uno,
+ * e seguono la distribuzione richiesta; l'ultimo blocco viene troncato alla lunghezza del testo.
+ *
+ * @param n Lunghezza del testo.
+ * @param factors Numero atteso di blocchi.
+ * @param distribution Distribuzione delle lunghezze: fixed, uniform (tra 1 e 2 volte la media) o geometric.
+ * @param alphabet Caratteri dell'alfabeto, in ordine crescente; almeno tre.
+ * @param random Generatore pseudocasuale.
+ * @return Il testo generato.
+ * @throw std::invalid_argument Se la distribuzione non e' riconosciuta.
+ */
+inline std::string generate_factors(std::size_t n, std::size_t factors, const std::string& distribution,
+                                    const std::string& alphabet, std::mt19937_64& random) {
+    const double mean = std::max(1.0, static_cast<double>(n) / std::max<std::size_t>(factors, 1));
+    const std::size_t base = alphabet.size() - 1;
+
+    // Cifre dell'indice sufficienti per tutti i blocchi, anche con le lunghezze minime.
+    std::size_t digits = 1;
+    for (std::size_t capacity = base; capacity * (digits + 1) < n; capacity *= base) {
+        ++digits;
+    }
+
+    std::uniform_int_distribution<std::size_t> uniform(1, std::max<std::size_t>(1, 2 * mean - 1));
+    std::geometric_distribution<std::size_t> geometric(1.0 / mean);
+    std::uniform_int_distribution<std::size_t> letter(0, base - 1);
+
+    std::string text;
+    text.reserve(n);
+    for (std::size_t block = 0; text.size() < n; ++block) {
+        std::size_t length;
+        if (distribution == "fixed") {
+            length = static_cast<std::size_t>(mean);
+        } else if (distribution == "uniform") {
+            length = uniform(random);
+        } else if (distribution == "geometric") {
+            length = 1 + geometric(random);
+        } else {
+            throw std::invalid_argument("Unknown length distribution: " + distribution);
+        }
+        length = std::min(std::max(length, digits + 1), n - text.size());
+
+        std::string current(1, alphabet.back());
+        for (std::size_t d = digits, value = block; d > 0; --d) {
+            std::size_t power = 1;
+            for (std::size_t p = 1; p < d; ++p) {
+                power *= base;
+            }
+            current.push_back(alphabet[value / power % base]);
+        }
+        while (current.size() < length) {
+            current.push_back(alphabet[letter(random)]);
+        }
+        current.resize(length);
+        text += current;
+    }
+    return text;
+}
+
+/**
+ * @brief Genera un testo secondo i parametri dati.
+ * @param options Parametri di generazione.
+ * @return Il testo generato.
+ * @throw std::invalid_argument Se il modello o i parametri non sono validi.
+ */
+inline std::string generate_text(const GeneratorOptions& options) {
+    if (options.sigma < 1 || options.sigma > 26) {
+        throw std::invalid_argument("The alphabet size must be between 1 and 26");
+    }
+    std::string alphabet;
+    for (unsigned int i = 0; i < options.sigma; ++i) {
+        alphabet.push_back(static_cast<char>('a' + i));
+    }
+    std::mt19937_64 random(options.seed);
+
+    if (options.model == "fibonacci") {
+        return generate_fibonacci(options.length);
+    }
+    if (options.model == "random") {
+        return generate_uniform(options.length, alphabet, random);
+    }
+    if (options.model == "dna") {
+        return generate_uniform(options.length, "acgt", random);
+    }
+    if (options.model == "bytes") {
+        std::string bytes(256, '\0');
+        for (std::size_t c = 0; c < bytes.size(); ++c) {
+            bytes[c] = static_cast<char>(c);
+        }
+        return generate_uniform(options.length, bytes, random);
+    }
+    if (options.model == "periodic") {
+        if (options.period == 0) {
+            throw std::invalid_argument("The period must be positive");
+        }
+        return generate_periodic(options.length, options.period, alphabet, options.mutation, random);
+    }
+    if (options.model == "factors") {
+        if (options.sigma < 3) {
+            throw std::invalid_argument("The factors model needs at least three letters");
+        }
+        return generate_factors(options.length, options.factors, options.distribution, alphabet, random);
+    }
+    throw std::invalid_argument("Unknown model: " + options.model);
+}
+
+#endif //ICFL_GENERATOR_HPP
@@ -324,6 +324,22 @@ namespace pasta {
             std::fill_n(raw_data_, size_, fill_value);
         }
 
+        /*!
+         * \brief Constructor. Creates a bit vector on top of externally managed
+         * 64-bit words, e.g., memory obtained from an arena.
+         *
+         * The bit vector does not own the words: they must contain at least
+         * <tt>(size >> 6) + 1</tt> elements and outlive the bit vector. Such a
+         * bit vector must not be resized.
+         * \param data Pointer to the words used to store the bits.
+         * \param size Number of bits the bit vector contains.
+         */
+        BitVector(RawDataPointer const data, size_t const size) noexcept
+                : bit_size_(size),
+                  size_((bit_size_ >> 6) + 1),
+                  data_(),
+                  raw_data_(data) {}
+
         /*!
          * \brief Access operator to read/write to a bit of the bit vector.
          * \param index Index of the bit to be read/write to in the bit vector.
@@ -20,44 +20,313 @@
 
 #pragma once
 
+#include "pasta/bit_vector/bit_vector.hpp"
+#include "pasta/bit_vector/support/popcount.hpp"
+#include "pasta/bit_vector/support/select.hpp"
+#include "pasta/utils/debug_asserts.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
 namespace pasta {
 
 /*! \file */
 
 /*!
- * \brief Interface for compressed bit vectors that use pasta's rank and select
- * interface.
+ * \brief Block compressed bit vector with integrated rank and select support.
+ *
+ * The bit vector is divided into blocks of 512 bits (the size of an L2-block
+ * of \ref FlatRankSelect). Blocks that contain only zeros or only ones are not
+ * stored, all other blocks are stored verbatim. For each block, a single
+ * 64-bit word stores the number of ones before the block (40 bits, as in
+ * \ref FlatRankSelect) and the type of the block (24 bits): 0 for an all-zero
+ * block, 1 for an all-one block, and 2 + i for the i-th stored block.
+ *
+ * Skewed bit vectors, i.e., bit vectors containing long runs of zeros or ones,
+ * require roughly 1/8 of the space of the uncompressed bit vector, while the
+ * space of dense random bit vectors grows by at most 12.5%.
  *
- * This interface is currently work in progress and should not yet be used in
- * production.
+ * The queries \c rank1, \c rank0, and \c select1 have the same semantics as
+ * the ones of \ref FlatRankSelect. Bit vectors of length up to 2^40 with at
+ * most 2^24 - 2 stored blocks are supported.
+ *
+ * The bit vector is allocator-aware: the block entries and the stored words
+ * are allocated through a polymorphic allocator, which is propagated by
+ * uses-allocator construction (e.g., \c polymorphic_allocator::new_object),
+ * so the bit vector can live in the same memory resource as its owner.
  */
 class BlockCompressedBitVector {
 public:
+  //! Allocator of the block entries and of the stored words.
+  using allocator_type = std::pmr::polymorphic_allocator<uint64_t>;
+
+private:
+  //! Number of bits in a block.
+  static constexpr size_t BLOCK_BIT_SIZE = 512;
+  //! Number of 64-bit words in a block.
+  static constexpr size_t BLOCK_WORD_SIZE = BLOCK_BIT_SIZE / 64;
+  //! Number of bits used to store the rank before a block.
+  static constexpr size_t RANK_BITS = 40;
+  //! Mask to extract the rank before a block.
+  static constexpr uint64_t RANK_MASK = (1ULL << RANK_BITS) - 1;
+  //! Type of a block containing only zeros.
+  static constexpr uint64_t ZERO_BLOCK = 0;
+  //! Type of a block containing only ones.
+  static constexpr uint64_t ONE_BLOCK = 1;
+  //! Largest type, i.e., the type of the last block that can be stored.
+  static constexpr uint64_t MAX_TYPE = (1ULL << (64 - RANK_BITS)) - 1;
+
+  //! Number of bits in the bit vector.
+  size_t size_ = 0;
+  //! Rank before and type of each block (and a sentinel containing the
+  //! total number of ones).
+  std::pmr::vector<uint64_t> blocks_;
+  //! 64-bit words of the stored blocks.
+  std::pmr::vector<uint64_t> words_;
+
+  //! Rank before the block with the given entry.
+  [[nodiscard]] static uint64_t rank_of(uint64_t const entry) {
+    return entry & RANK_MASK;
+  }
+
+  //! Type of the block with the given entry.
+  [[nodiscard]] static uint64_t type_of(uint64_t const entry) {
+    return entry >> RANK_BITS;
+  }
+
+public:
+  //! Default constructor: empty bit vector.
+  BlockCompressedBitVector() = default;
+
+  /*!
+   * \brief Constructor for an empty bit vector using the given allocator.
+   * \param alloc Allocator of the block entries and of the stored words.
+   */
+  explicit BlockCompressedBitVector(allocator_type const& alloc)
+      : blocks_(alloc), words_(alloc) {}
+
   /*!
-   * \brief Constructor for a block compressed bit vector that takes a \c
-   * BitVector and prepares the compression.
+   * \brief Constructor for a block compressed bit vector that compresses the
+   * 64-bit words of a bit vector.
    *
-   * To easier work with the rank and select data structures, the bit vector is
-   * only compressed as soon as compress() is called. If a rank and select data
-   * structure is computed for this compressed bit vector, this happens
-   * automatically, e.g.,
-   * ```cpp
-   * BitVector bv(1000);
-   * // Fill bv
-   * BlockCompressedBitVector bcbv(bv);
-   * FlatRankSelect(std::move(bcbv));
-   * ```
-   * results in a compressed bit vector `bcbv`.
+   * The words past the last bit are ignored.
+   *
+   * \param data 64-bit words of the bit vector (as returned by \c
+   * BitVector::data()).
+   * \param size Number of bits of the bit vector.
+   * \param alloc Allocator of the block entries and of the stored words.
+   */
+  BlockCompressedBitVector(std::span<uint64_t const> const data,
+                           size_t const size,
+                           allocator_type const& alloc = {})
+      : size_(size), blocks_(alloc), words_(alloc) {
+    size_t const block_count = (size_ + BLOCK_BIT_SIZE - 1) / BLOCK_BIT_SIZE;
+    blocks_.reserve(block_count + 1);
+
+    uint64_t rank = 0;
+    uint64_t buffer[BLOCK_WORD_SIZE];
+    for (size_t block = 0; block < block_count; ++block) {
+      // Copy the block, clearing the bits past the end of the bit vector.
+      size_t const first_bit = block * BLOCK_BIT_SIZE;
+      size_t const bits = std::min(BLOCK_BIT_SIZE, size_ - first_bit);
+      for (size_t w = 0; w < BLOCK_WORD_SIZE; ++w) {
+        size_t const word_bits = (w * 64 < bits) ? std::min<size_t>(64, bits - w * 64) : 0;
+        uint64_t const word = (word_bits > 0) ? data[block * BLOCK_WORD_SIZE + w] : 0ULL;
+        buffer[w] = (word_bits == 64) ? word : (word & ((1ULL << word_bits) - 1));
+      }
+      uint64_t const ones = popcount<BLOCK_WORD_SIZE>(buffer);
+
+      uint64_t type;
+      if (ones == 0) {
+        type = ZERO_BLOCK;
+      } else if (ones == bits) {
+        type = ONE_BLOCK;
+      } else {
+        type = 2 + words_.size() / BLOCK_WORD_SIZE;
+        if (type > MAX_TYPE) {
+          throw std::length_error("BlockCompressedBitVector: too many blocks");
+        }
+        words_.insert(words_.end(), buffer, buffer + BLOCK_WORD_SIZE);
+      }
+      blocks_.push_back(rank | (type << RANK_BITS));
+      rank += ones;
+    }
+    if (rank > RANK_MASK) {
+      throw std::length_error("BlockCompressedBitVector: too many bits");
+    }
+    blocks_.push_back(rank);
+    words_.shrink_to_fit();
+  }
+
+  /*!
+   * \brief Constructor for a block compressed bit vector that compresses a
+   * \c BitVector. The bit vector is not modified.
    *
    * \param bv Bit vector for which the block compressed bit vector is computed.
+   * \param alloc Allocator of the block entries and of the stored words.
+   */
+  explicit BlockCompressedBitVector(BitVector const& bv,
+                                    allocator_type const& alloc = {})
+      : BlockCompressedBitVector(bv.data(), bv.size(), alloc) {}
+
+  //! Copy constructor, using the allocator of \c other.
+  BlockCompressedBitVector(BlockCompressedBitVector const& other) = default;
+
+  /*!
+   * \brief Copy constructor using the given allocator.
+   * \param other Bit vector to copy.
+   * \param alloc Allocator of the copy.
+   */
+  BlockCompressedBitVector(BlockCompressedBitVector const& other,
+                           allocator_type const& alloc)
+      : size_(other.size_), blocks_(other.blocks_, alloc),
+        words_(other.words_, alloc) {}
+
+  //! Move constructor, taking the allocator of \c other.
+  BlockCompressedBitVector(BlockCompressedBitVector&& other) noexcept = default;
+
+  /*!
+   * \brief Move constructor using the given allocator. If it differs from the
+   * allocator of \c other, the words are copied.
+   * \param other Bit vector to move.
+   * \param alloc Allocator of the new bit vector.
+   */
+  BlockCompressedBitVector(BlockCompressedBitVector&& other,
+                           allocator_type const& alloc)
+      : size_(other.size_), blocks_(std::move(other.blocks_), alloc),
+        words_(std::move(other.words_), alloc) {}
+
+  //! Copy assignment.
+  BlockCompressedBitVector&
+  operator=(BlockCompressedBitVector const& other) = default;
+
+  //! Move assignment.
+  BlockCompressedBitVector&
+  operator=(BlockCompressedBitVector&& other) = default;
+
+  /*!
+   * \brief Allocator of the block entries and of the stored words.
+   * \return The allocator.
+   */
+  [[nodiscard]] allocator_type get_allocator() const {
+    return blocks_.get_allocator();
+  }
+
+  /*!
+   * \brief Number of bits of the bit vector.
+   * \return Number of bits.
+   */
+  [[nodiscard]] size_t size() const {
+    return size_;
+  }
+
+  /*!
+   * \brief Access the bit at the given position.
+   * \param index Position of the bit.
+   * \return \c true if the bit is set.
+   */
+  [[nodiscard]] bool operator[](size_t const index) const {
+    PASTA_ASSERT(index < size_, "Index out of bounds");
+    uint64_t const type = type_of(blocks_[index / BLOCK_BIT_SIZE]);
+    if (type < 2) {
+      return type == ONE_BLOCK;
+    }
+    size_t const offset = index % BLOCK_BIT_SIZE;
+    uint64_t const word =
+        words_[(type - 2) * BLOCK_WORD_SIZE + offset / 64];
+    return (word >> (offset % 64)) & 1ULL;
+  }
+
+  /*!
+   * \brief Computes the number of ones before the given position.
+   * \param index Position (exclusive), at most \c size().
+   * \return Number of ones in [0, index).
+   */
+  [[nodiscard]] size_t rank1(size_t const index) const {
+    PASTA_ASSERT(index <= size_, "Index out of bounds");
+    size_t const block = index / BLOCK_BIT_SIZE;
+    uint64_t const entry = blocks_[block];
+    size_t const offset = index % BLOCK_BIT_SIZE;
+    if (offset == 0) {
+      return rank_of(entry);
+    }
+    uint64_t const type = type_of(entry);
+    if (type == ZERO_BLOCK) {
+      return rank_of(entry);
+    }
+    if (type == ONE_BLOCK) {
+      return rank_of(entry) + offset;
+    }
+    uint64_t const* const words = words_.data() + (type - 2) * BLOCK_WORD_SIZE;
+    size_t result = rank_of(entry);
+    for (size_t w = 0; w < offset / 64; ++w) {
+      result += std::popcount(words[w]);
+    }
+    if (offset % 64 != 0) {
+      result += std::popcount(words[offset / 64] & ((1ULL << (offset % 64)) - 1));
+    }
+    return result;
+  }
+
+  /*!
+   * \brief Computes the number of zeros before the given position.
+   * \param index Position (exclusive), at most \c size().
+   * \return Number of zeros in [0, index).
+   */
+  [[nodiscard]] size_t rank0(size_t const index) const {
+    return index - rank1(index);
+  }
+
+  /*!
+   * \brief Returns the position of the rank-th one.
+   * \param rank Rank of the one (starting at 1), at most the number of ones.
+   * \return Position of the rank-th one in the bit vector.
+   */
+  [[nodiscard]] size_t select1(size_t const rank) const {
+    PASTA_ASSERT(rank > 0 && rank <= rank_of(blocks_.back()),
+                 "Rank out of bounds");
+    // Last block with fewer than rank ones before it.
+    auto const it = std::partition_point(
+        blocks_.begin(), blocks_.end() - 1,
+        [rank](uint64_t const entry) { return rank_of(entry) < rank; });
+    size_t const block = (it - blocks_.begin()) - 1;
+    uint64_t const entry = blocks_[block];
+    size_t local_rank = rank - rank_of(entry);
+    uint64_t const type = type_of(entry);
+    if (type == ONE_BLOCK) {
+      return block * BLOCK_BIT_SIZE + local_rank - 1;
+    }
+    uint64_t const* const words = words_.data() + (type - 2) * BLOCK_WORD_SIZE;
+    size_t w = 0;
+    for (size_t ones = std::popcount(words[w]); ones < local_rank;
+         ones = std::popcount(words[w])) {
+      local_rank -= ones;
+      ++w;
+    }
+    return block * BLOCK_BIT_SIZE + w * 64 + select(words[w], local_rank - 1);
+  }
+
+  /*!
+   * \brief Number of ones in the bit vector.
+   * \return Number of ones.
    */
-  BlockCompressedBitVector(BitVector&& bv) {}
+  [[nodiscard]] size_t count_ones() const {
+    return blocks_.empty() ? 0 : rank_of(blocks_.back());
+  }
 
   /*!
-   * \brief Creates a compressed version of the bit vector passed in the
-   * constructor and discards the uncompressed version.
+   * \brief Space used by the compressed bit vector (including rank and select
+   * support) in bytes.
+   * \return Space usage in bytes.
    */
-  void compress() {}
+  [[nodiscard]] size_t space_usage() const {
+    return sizeof(*this) + (blocks_.capacity() + words_.capacity()) * sizeof(uint64_t);
+  }
 
 }; // class BlockCompressedBitVector
 
@@ -106,7 +106,7 @@ public:
    */
   FlatRank(VectorType& bv)
       : data_size_(bv.size_),
-        data_(bv.data_.data()),
+        data_(bv.raw_data_),
         l12_((data_size_ / FlatRankSelectConfig::L1_WORD_SIZE) + 1) {
     init();
   }
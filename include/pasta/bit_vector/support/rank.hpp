@@ -126,7 +126,7 @@ public:
    */
   Rank(VectorType& bv)
       : data_size_(bv.size_),
-        data_(bv.data_.data()),
+        data_(bv.raw_data_),
         bit_size_(bv.size()),
         l0_((data_size_ / PopcntRankSelectConfig::L0_WORD_SIZE) + 2),
         l12_((data_size_ / PopcntRankSelectConfig::L1_WORD_SIZE) + 1) {
@@ -99,7 +99,7 @@ public:
    */
   WideRank(VectorType& bv)
       : data_size_(bv.size_),
-        data_(bv.data_.data()),
+        data_(bv.raw_data_),
         l1_((data_size_ / WideRankSelectConfig::L1_WORD_SIZE) + 1),
         l2_((data_size_ / WideRankSelectConfig::L2_WORD_SIZE) + 1) {
     init();
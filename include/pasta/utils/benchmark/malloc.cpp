@@ -18,6 +18,8 @@
  *
  ******************************************************************************/
 
+#include <cerrno>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
@@ -30,6 +32,8 @@ namespace pasta {
 
   //! Sentinel used to mark monitored memory.
   constexpr size_t MEMORY_SENTINEL = 0x0D15EA5E;
+  //! Sentinel used to mark monitored memory with extended alignment.
+  constexpr size_t ALIGNED_MEMORY_SENTINEL = 0x0A11C0DE;
 
   /*!
    * \brief Header stored in front of allocated memory.
@@ -47,6 +51,39 @@ namespace pasta {
       : sentinel(_sentinel), size(_size){ }
   }; // struct MemoryBlockHeader
 
+  /*!
+   * \brief Allocates monitored memory with the given alignment.
+   *
+   * The header is stored right in front of the aligned memory and is preceded
+   * by the pointer returned by \c __libc_malloc, which is needed to free it.
+   *
+   * \param alignment Alignment of the memory, a power of two.
+   * \param size Size of the memory.
+   * \return Pointer to the aligned memory or \c nullptr.
+   */
+  void* aligned_monitored_malloc(size_t const alignment, size_t const size) {
+    if (size == 0) [[unlikely]] {
+      return nullptr;
+    }
+    size_t const prefix = sizeof(void*) + sizeof(MemoryBlockHeader);
+    void* raw = __libc_malloc(size + prefix + alignment);
+    if (raw == nullptr) [[unlikely]] {
+      return raw;
+    }
+    uintptr_t const first = reinterpret_cast<uintptr_t>(raw) + prefix;
+    char* ptr = reinterpret_cast<char*>((first + alignment - 1) & ~(alignment - 1));
+    auto* mem_block = reinterpret_cast<MemoryBlockHeader*>(
+      ptr - sizeof(MemoryBlockHeader));
+    mem_block->sentinel = ALIGNED_MEMORY_SENTINEL;
+    mem_block->size = size;
+    reinterpret_cast<void**>(mem_block)[-1] = raw;
+
+    if (MemoryMonitorCallbacks::malloc_callback != nullptr) [[likely]] {
+      MemoryMonitorCallbacks::malloc_callback(size);
+    }
+    return ptr;
+  }
+
   void (*MemoryMonitorCallbacks::malloc_callback)(size_t) = nullptr;
   void (*MemoryMonitorCallbacks::free_callback)(size_t) = nullptr;
   void (*MemoryMonitorCallbacks::uncounted_callback)(void) = nullptr;
@@ -85,6 +122,11 @@ extern "C" void free(void* ptr) {
       pasta::MemoryMonitorCallbacks::free_callback(mem_block->size);
     }
     __libc_free(mem_block);
+  } else if (mem_block->sentinel == pasta::ALIGNED_MEMORY_SENTINEL) {
+    if (pasta::MemoryMonitorCallbacks::free_callback != nullptr) [[likely]] {
+      pasta::MemoryMonitorCallbacks::free_callback(mem_block->size);
+    }
+    __libc_free(reinterpret_cast<void**>(mem_block)[-1]);
   } else [[unlikely]] {
     if (pasta::MemoryMonitorCallbacks::uncounted_callback != nullptr)[[likely]]{
       pasta::MemoryMonitorCallbacks::uncounted_callback();
@@ -112,7 +154,8 @@ extern "C" void* realloc(void* ptr, size_t size) {
   } else [[likely]] {
   auto mem_block = reinterpret_cast<pasta::MemoryBlockHeader*>(
     static_cast<char*>(ptr) - sizeof(pasta::MemoryBlockHeader));
-    if (mem_block->sentinel == pasta::MEMORY_SENTINEL) [[likely]] {
+    if (mem_block->sentinel == pasta::MEMORY_SENTINEL ||
+        mem_block->sentinel == pasta::ALIGNED_MEMORY_SENTINEL) [[likely]] {
       size_t const cur_size = mem_block->size;
       if (size <= cur_size) {
 	mem_block->size = size;
@@ -120,7 +163,7 @@ extern "C" void* realloc(void* ptr, size_t size) {
       } else {
 	void* new_ptr = malloc(size);
 	memcpy(new_ptr, ptr, mem_block->size);
-	free(mem_block);
+	free(ptr);
 	return new_ptr;
       }
     } else [[unlikely]] {
@@ -130,4 +173,24 @@ extern "C" void* realloc(void* ptr, size_t size) {
 }
 
 
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+  return pasta::aligned_monitored_malloc(alignment, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) {
+  return pasta::aligned_monitored_malloc(alignment, size);
+}
+
+extern "C" int posix_memalign(void** memptr, size_t alignment, size_t size) {
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void* ptr = pasta::aligned_monitored_malloc(alignment, size);
+  if (ptr == nullptr && size != 0) {
+    return ENOMEM;
+  }
+  *memptr = ptr;
+  return 0;
+}
+
 /******************************************************************************/
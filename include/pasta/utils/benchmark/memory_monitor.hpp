@@ -47,6 +47,8 @@ struct MemoryMonitorStats {
   size_t number_free;
   //! The number of malloc/free-call not tracked by the \c MemoryMonitor.
   size_t uncounted;
+  //! The highest value of \c cur_peak since the last reset.
+  size_t peak;
 
   /*!
    * \brief Constructor. Setting all members.
@@ -58,19 +60,22 @@ struct MemoryMonitorStats {
    * \param _number_free The amount of free-calls.
    * \param _uncounted. The number of malloc/free-call not tracked by the
    * \c MemoryMonitor.
+   * \param _peak The highest value of \c cur_peak since the last reset.
    */
   MemoryMonitorStats(size_t const _cur_peak,
                      size_t const _total_size_malloc,
                      size_t const _total_size_free,
                      size_t const _number_malloc,
                      size_t const _number_free,
-                     size_t const _uncounted)
+                     size_t const _uncounted,
+                     size_t const _peak = 0)
       : cur_peak(_cur_peak),
         total_size_malloc(_total_size_malloc),
         total_size_free(_total_size_free),
         number_malloc(_number_malloc),
         number_free(_number_free),
-        uncounted(_uncounted) {}
+        uncounted(_uncounted),
+        peak(_peak) {}
 }; // struct MemoryMonitorStats
 
 //! Simple output of \c MemoryMonitorStats.
@@ -80,7 +85,8 @@ std::ostream& operator<<(std::ostream& os, const MemoryMonitorStats& mms) {
      << "total_size_free=" << mms.total_size_free << " "
      << "number_malloc=" << mms.number_malloc << " "
      << "number_free=" << mms.number_free << " "
-     << "uncounted=" << mms.uncounted;
+     << "uncounted=" << mms.uncounted << " "
+     << "peak=" << mms.peak;
   return os;
 }
 
@@ -107,9 +113,13 @@ class MemoryMonitor {
 
   //! Callback for malloc (used in malloc.cpp).
   static void malloc_callback(size_t const size) {
-    instance().memory_stats_.cur_peak += size;
-    instance().memory_stats_.total_size_malloc += size;
-    ++instance().memory_stats_.number_malloc;
+    MemoryMonitorStats& cur_stats = instance().memory_stats_;
+    cur_stats.cur_peak += size;
+    cur_stats.total_size_malloc += size;
+    ++cur_stats.number_malloc;
+    if (cur_stats.cur_peak > cur_stats.peak) {
+      cur_stats.peak = cur_stats.cur_peak;
+    }
   }
 
   //! Callback for free (used in malloc.cpp)
@@ -140,6 +150,14 @@ public:
     instance().memory_stats_ = {0, 0, 0, 0, 0, 0};
   }
 
+  /*!
+   * \brief Restart the peak measurement from the currently allocated memory,
+   * keeping all other measurements.
+   */
+  void reset_peak() {
+    memory_stats_.peak = memory_stats_.cur_peak;
+  }
+
   /*!
    * \brief Get the current stats of the monitored memory.
    * \return Current stats of the monitored memory.
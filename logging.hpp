@@ -0,0 +1,37 @@
+#ifndef ICFL_LOGGING_HPP
+#define ICFL_LOGGING_HPP
+
+/**
+ * @file logging.hpp
+ * @brief Livelli di verbosita' per la diagnostica della costruzione, basata su tlx/logger.
+ *
+ * I messaggi diagnostici sono emessi con LOGC(log_enabled(livello)): quando il livello non e' attivo
+ * la condizione e' un solo confronto e lo stream non viene costruito, quindi nella modalita' di
+ * default (Verbosity::quiet) i cicli di costruzione non formattano ne' scrivono nulla.
+ */
+
+#include <tlx/logger.hpp>
+
+/**
+ * @brief Livelli di verbosita', in ordine crescente di dettaglio.
+ */
+enum class Verbosity : int {
+    quiet = 0, ///< Nessun messaggio: solo il risultato.
+    phases = 1, ///< Fattorizzazione e fasi principali.
+    nodes = 2, ///< Ogni nodo del prefix-tree e il relativo insertion target.
+    lists = 3 ///< Ogni fusione di g-list durante la costruzione del suffix array (output quadratico).
+};
+
+/// Livello di verbosita' corrente, impostato dal programma principale.
+inline Verbosity verbosity = Verbosity::quiet;
+
+/**
+ * @brief Indica se i messaggi del livello dato devono essere emessi.
+ * @param level Livello del messaggio.
+ * @return true se il livello corrente e' almeno level.
+ */
+inline bool log_enabled(Verbosity level) {
+    return static_cast<int>(verbosity) >= static_cast<int>(level);
+}
+
+#endif //ICFL_LOGGING_HPP
@@ -1,7 +1,15 @@
 #include "func.hpp"
 #include "tree.hpp"
 #include "node.hpp"
+#include "suffix_array_io.hpp"
+#include "fm_index.hpp"
 
+#include <tlx/cmdline_parser.hpp>
+#include <tlx/timestamp.hpp>
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <sstream>
 #include <string>
 //run this command for leaks: leaks -atExit -- cmake-build-debug/ICFL
 
@@ -66,48 +74,369 @@ void test_comparisons() {
     std::cout << std::endl;
 }
  */
-int main()
+
+/**
+ * @brief Fasi della costruzione richieste dalla riga di comando.
+ */
+struct Phases {
+    bool tree = false; ///< Costruzione del prefix tree.
+    bool sa = false; ///< Assemblaggio del suffix array.
+    bool verify = false; ///< Verifica del suffix array.
+    bool lcp = false; ///< Calcolo dell'array LCP.
+    bool fm_index = false; ///< Calcolo della BWT e dell'FM-index.
+};
+
+/**
+ * @brief Opzioni della riga di comando.
+ */
+struct Options {
+    std::string input; ///< File di input.
+    bool factor_file = false; ///< L'input e' un file di fattori invece di un testo grezzo.
+    bool collection = false; ///< L'input e' una collezione di documenti, uno per riga.
+    std::string output; ///< File di output, vuoto per stampare il suffix array.
+    std::string lcp_output; ///< File di output dell'array LCP, vuoto per stamparlo (con la fase lcp).
+    std::string fm_index_output; ///< File di output dell'FM-index, vuoto per stampare la BWT (con la fase fmindex).
+    std::size_t sample_rate = 32; ///< Distanza tra le posizioni campionate del suffix array nell'FM-index.
+    std::string format = "binary"; ///< Formato del file di output: binary o text.
+    uint32_t entry_bytes = 0; ///< Byte per posizione nel formato binario (0 = minimo sufficiente).
+    unsigned int threads = 1; ///< Numero di thread.
+    uint64_t memory_budget = 0; ///< Limite di memoria in byte (0 = nessun limite).
+    SuffixArrayEngine engine = SuffixArrayEngine::automatic; ///< Algoritmo di costruzione del suffix array.
+    Phases phases; ///< Fasi da eseguire.
+    bool quiet = false; ///< Nessun output oltre agli errori.
+};
+
+/**
+ * @brief Interpreta l'elenco delle fasi, separate da virgole; ogni fase include quelle da cui dipende.
+ *
+ * La fattorizzazione viene sempre calcolata: "factorize" da sola si ferma dopo di essa.
+ *
+ * @param list Elenco delle fasi (factorize, tree, sa, verify, lcp, fmindex).
+ * @return Fasi da eseguire.
+ * @throw std::invalid_argument Se una fase non e' riconosciuta.
+ */
+Phases parse_phases(const std::string& list) {
+    Phases phases;
+    std::istringstream stream(list);
+    std::string phase;
+    while (std::getline(stream, phase, ',')) {
+        if (phase == "verify") {
+            phases.verify = true;
+        } else if (phase == "lcp") {
+            phases.lcp = true;
+        } else if (phase == "fmindex") {
+            phases.fm_index = true;
+        } else if (phase != "factorize" && phase != "tree" && phase != "sa") {
+            throw std::invalid_argument("Unknown phase: " + phase);
+        }
+        phases.sa |= phase == "sa" || phase == "verify" || phase == "lcp" || phase == "fmindex";
+        phases.tree |= phases.sa || phase == "tree";
+    }
+    return phases;
+}
+
+/**
+ * @brief Scrive un array nel formato testuale, come la stampa del suffix array.
+ * @tparam Position Tipo dei valori.
+ * @param filename Percorso del file da scrivere.
+ * @param values Valori da scrivere.
+ * @throw std::runtime_error Se il file non puo' essere scritto.
+ */
+template <typename Position>
+void write_text_array(const std::string& filename, std::span<const Position> values) {
+    std::ofstream file(filename);
+    file << g_list_to_string<Position>(values) << std::endl;
+    if (!file) {
+        throw std::runtime_error("Error writing file: " + filename);
+    }
+}
+
+/**
+ * @brief Costruisce il suffix array con posizioni di tipo Position, poi stampa o scrive il risultato e, con le
+ * fasi lcp e fmindex, l'array LCP e l'FM-index.
+ *
+ * Con il prefix tree costruisce l'albero e lo assembla; con SA-IS la fase tree non produce nulla e il suffix
+ * array viene calcolato direttamente dal testo.
+ *
+ * @tparam Position Tipo delle posizioni, sufficiente per la lunghezza del testo.
+ * @param factors Fattorizzazione ICFL del testo.
+ * @param options Opzioni della riga di comando.
+ * @throw std::runtime_error Se la stima della memoria supera il limite o la verifica fallisce.
+ */
+template <typename Position>
+void run(Factorization factors, const Options& options) {
+    SuffixArrayEngine engine = options.engine;
+    if (engine == SuffixArrayEngine::automatic) {
+        engine = choose_engine(factors);
+        LOGC(log_enabled(Verbosity::phases)) << "engine: " << engine_name(engine) << " (estimated tree work "
+                                             << estimate_prefix_tree_work(factors) / std::max<std::size_t>(factors.text().size(), 1)
+                                             << " per character)";
+    }
+
+    uint64_t memory = engine == SuffixArrayEngine::sais ? estimate_sais_memory<Position>(factors.text().size())
+                                                        : estimate_construction_memory<Position>(factors);
+    LOGC(log_enabled(Verbosity::phases)) << "estimated memory: at least " << memory << " bytes";
+    if (options.memory_budget != 0 && memory > options.memory_budget) {
+        throw std::runtime_error("Memory budget exceeded: at least " + std::to_string(memory) + " bytes needed");
+    }
+    if (!options.phases.tree) {
+        return;
+    }
+
+    std::optional<BasicTree<Position>> tree;
+    const Factorization* icfl = &factors;
+    double start = tlx::timestamp();
+    if (engine == SuffixArrayEngine::prefix_tree) {
+        tree.emplace(build_tree<Position>(std::move(factors), options.threads));
+        icfl = &tree->get_icfl();
+        LOGC(log_enabled(Verbosity::phases)) << "prefix tree built in " << tlx::timestamp() - start << " s";
+        if (log_enabled(Verbosity::nodes)) {
+            std::cout << "STAMPA ALBERO: " << std::endl;
+            print_tree(tree->get_root());
+        }
+    }
+    if (!options.phases.sa) {
+        return;
+    }
+
+    start = tlx::timestamp();
+    std::vector<Position> sa;
+    if (!tree) {
+        sa = build_suffix_array_sais<Position>(icfl->text());
+    } else if (log_enabled(Verbosity::lists)) {
+        //Ogni fusione viene tracciata dalla costruzione originale in post-ordine, che lascia il SA nella g-list della radice
+        build_list(tree->get_root());
+        sa.assign(tree->get_root()->get_g_list().begin(), tree->get_root()->get_g_list().end());
+    } else {
+        sa = build_suffix_array(tree->get_root());
+    }
+    LOGC(log_enabled(Verbosity::phases)) << "suffix array assembled in " << tlx::timestamp() - start << " s";
+
+    if (options.phases.verify) {
+        start = tlx::timestamp();
+        if (!is_suffix_array<Position>(icfl->text(), sa, options.threads)) {
+            throw std::runtime_error("Suffix array verification failed");
+        }
+        LOGC(log_enabled(Verbosity::phases)) << "suffix array verified in " << tlx::timestamp() - start << " s";
+    }
+
+    if (options.output.empty()) {
+        if (!options.quiet) {
+            std::cout << "SA(T): ";
+            print_g_list_vector<Position>(sa);
+        }
+    } else if (options.format == "binary") {
+        write_suffix_array<Position>(options.output, sa, *icfl, options.entry_bytes);
+        LOGC(log_enabled(Verbosity::phases)) << "suffix array written to " << options.output;
+    } else {
+        write_text_array<Position>(options.output, sa);
+        LOGC(log_enabled(Verbosity::phases)) << "suffix array written to " << options.output;
+    }
+
+    if (options.phases.lcp) {
+        start = tlx::timestamp();
+        std::vector<Position> lcp = build_lcp_array<Position>(icfl->text(), sa, options.threads);
+        LOGC(log_enabled(Verbosity::phases)) << "LCP array computed in " << tlx::timestamp() - start << " s";
+
+        if (options.lcp_output.empty()) {
+            if (!options.quiet) {
+                std::cout << "LCP(T): ";
+                print_g_list_vector<Position>(lcp);
+            }
+        } else if (options.format == "binary") {
+            write_lcp_array<Position>(options.lcp_output, lcp, *icfl, options.entry_bytes);
+            LOGC(log_enabled(Verbosity::phases)) << "LCP array written to " << options.lcp_output;
+        } else {
+            write_text_array<Position>(options.lcp_output, lcp);
+            LOGC(log_enabled(Verbosity::phases)) << "LCP array written to " << options.lcp_output;
+        }
+    }
+
+    if (options.phases.fm_index) {
+        start = tlx::timestamp();
+        FMIndex index(icfl->text(), std::span<const Position>(sa), options.sample_rate);
+        LOGC(log_enabled(Verbosity::phases)) << "BWT and FM-index built in " << tlx::timestamp() - start << " s";
+        if (options.fm_index_output.empty()) {
+            if (!options.quiet) {
+                uint64_t primary;
+                std::string bwt = build_bwt<Position>(icfl->text(), sa, primary);
+                bwt[primary] = '$';
+                std::cout << "BWT(T): " << bwt << std::endl;
+            }
+        } else {
+            index.save(options.fm_index_output);
+            LOGC(log_enabled(Verbosity::phases)) << "FM-index written to " << options.fm_index_output;
+        }
+    }
+}
+
+/**
+ * @brief Costruisce il suffix array generalizzato di una collezione con posizioni di tipo Position, poi lo
+ * stampa o lo scrive come coppie (documento, offset).
+ *
+ * Le fasi tree e sa non sono separabili: con il prefix tree gli alberi dei documenti vengono costruiti e
+ * assemblati uno alla volta da build_generalized_suffix_array().
+ *
+ * @tparam Position Tipo delle posizioni, sufficiente per la lunghezza del testo e il numero di documenti.
+ * @param collection Collezione.
+ * @param factors Fattorizzazione della concatenazione, con la ICFL di ogni documento.
+ * @param options Opzioni della riga di comando.
+ * @throw std::runtime_error Se la stima della memoria supera il limite o la verifica fallisce.
+ */
+template <typename Position>
+void run_collection(const Collection& collection, const Factorization& factors, const Options& options) {
+    SuffixArrayEngine engine = options.engine;
+    if (engine == SuffixArrayEngine::automatic) {
+        engine = choose_engine(collection, factors);
+        LOGC(log_enabled(Verbosity::phases)) << "engine: " << engine_name(engine);
+    }
+
+    const uint64_t n = collection.text().size();
+    uint64_t memory = engine == SuffixArrayEngine::sais ? estimate_sais_memory<Position>(n + collection.size())
+                                                        : estimate_construction_memory<Position>(factors);
+    LOGC(log_enabled(Verbosity::phases)) << "estimated memory: at least " << memory << " bytes";
+    if (options.memory_budget != 0 && memory > options.memory_budget) {
+        throw std::runtime_error("Memory budget exceeded: at least " + std::to_string(memory) + " bytes needed");
+    }
+    if (!options.phases.sa) {
+        return;
+    }
+
+    double start = tlx::timestamp();
+    std::vector<Position> gsa = build_generalized_suffix_array<Position>(collection, factors, engine, options.threads);
+    LOGC(log_enabled(Verbosity::phases)) << "generalized suffix array of " << collection.size() << " documents built in "
+                                         << tlx::timestamp() - start << " s";
+
+    if (options.phases.verify) {
+        start = tlx::timestamp();
+        if (!is_generalized_suffix_array<Position>(collection, gsa, options.threads)) {
+            throw std::runtime_error("Generalized suffix array verification failed");
+        }
+        LOGC(log_enabled(Verbosity::phases)) << "generalized suffix array verified in " << tlx::timestamp() - start << " s";
+    }
+
+    if (options.output.empty()) {
+        if (!options.quiet) {
+            std::vector<DocumentSuffix<Position>> suffixes = to_document_suffixes<Position>(collection, gsa);
+            std::cout << "GSA(T): " << document_suffixes_to_string<Position>(suffixes) << std::endl;
+        }
+    } else if (options.format == "binary") {
+        write_generalized_suffix_array<Position>(options.output, gsa, factors, options.entry_bytes);
+        LOGC(log_enabled(Verbosity::phases)) << "generalized suffix array written to " << options.output;
+    } else {
+        std::vector<DocumentSuffix<Position>> suffixes = to_document_suffixes<Position>(collection, gsa);
+        std::ofstream file(options.output);
+        file << document_suffixes_to_string<Position>(suffixes) << std::endl;
+        if (!file) {
+            throw std::runtime_error("Error writing file: " + options.output);
+        }
+        LOGC(log_enabled(Verbosity::phases)) << "generalized suffix array written to " << options.output;
+    }
+}
+
+int main(int argc, char* argv[])
 {
+    Options options;
+    std::string phases = "factorize,tree,sa";
+    std::string engine = "auto";
+    unsigned int level = static_cast<unsigned int>(Verbosity::quiet);
 
-    std::list<std::string> icfl_t = build_input_ICFL("../input.txt");
-    std::cout << "ICFL(T) from input.txt: ";
-    print_list(icfl_t); std::cout << std::endl;
-
-    //Create suffix
-
-    std::string x = "a";
-    std::string z = "abca";
-    std::string y = "bca";
-    std::cout << "Siano x = " << x << " e z = xy = " << z << std::endl;
-    //Create x and z list
-    std::list<int> xgList = build_xgList();
-    std::list<int> zgList = build_zgList();
-    std::cout << "[x]_g-list = "; print_list(xgList);
-    std::cout << "[z]_g-list = "; print_list(zgList);
-
-    /*
-    //Create a bit vectors
-    pasta::BitVector bv_x(4, 1);
-    pasta::BitVector bv_z(4, 0);
-    bv_z[2] = 1;
-    bv_z[3] = 1;
-    std::cout << "bit vector Bx: "; print_bv(bv_x);
-    std::cout << "bit vector Bz: "; print_bv(bv_z);
-    unsigned int h = getInsertionTarget(bv_x, bv_z, icfl_t, get_strings_difference("abca", "a"));
-    std::cout << "Insertion target h: " << h << std::endl;
-    std::cout << "-----" << std::endl;
-    std::cout << get_strings_difference("ciao", "ci") << std::endl;
-    */
-    //std::string t = build_text_from_ICFL(icfl_t);
-
-    Tree tree = build_tree(icfl_t);
-    std::cout << "STAMPA ALBERO: " << std::endl;
-    print_tree(tree.get_root());
-
-    build_list(tree.get_root());
+    tlx::CmdlineParser cp;
+    cp.set_description("Builds the suffix array of a text from its Inverse Lyndon Factorization (ICFL).");
+    cp.add_param_string("input", options.input, "Input file: a raw text, or a factor file with --factors");
+    cp.add_flag('f', "factors", options.factor_file,
+                "The input is a factor file (number of factors, then one factor per line)");
+    cp.add_flag('c', "collection", options.collection,
+                "The input is a collection of documents, one per line: build their generalized suffix array");
+    cp.add_string('o', "output", options.output, "Output file (default: print the suffix array)");
+    cp.add_string('l', "lcp", options.lcp_output,
+                  "LCP array output file, in the output format; implies the lcp phase");
+    cp.add_string('x', "fm-index", options.fm_index_output,
+                  "FM-index output file (BWT on a wavelet matrix, SA samples); implies the fmindex phase");
+    cp.add_size_t('s', "sample-rate", options.sample_rate,
+                  "Distance between the suffix array samples of the FM-index (default: 32)");
+    cp.add_string('F', "format", options.format, "Output file format: binary (default) or text");
+    cp.add_uint('b', "entry-bytes", options.entry_bytes,
+                "Bytes per position in the binary format: 4, 5 or 8 (default: smallest that fits)");
+    cp.add_string('e', "engine", engine,
+                  "Suffix array construction: tree (prefix tree), sais, or auto to choose from the factors (default: auto)");
+    cp.add_uint('t', "threads", options.threads, "Number of threads used to build the prefix tree and to verify the suffix array (default: 1)");
+    cp.add_bytes('m', "memory", options.memory_budget,
+                 "Memory budget, e.g. 16GiB: runs that certainly exceed it are rejected (default: none)");
+    cp.add_string('p', "phases", phases,
+                  "Comma-separated phases to run: factorize, tree, sa, verify, lcp, fmindex (default: factorize,tree,sa)");
+    cp.add_uint('v', "verbosity", level, "Diagnostics: 0 none, 1 phases, 2 nodes, 3 g-list merges (default: 0)");
+    cp.add_flag('q', "quiet", options.quiet, "No output except errors");
 
+    if (!cp.process(argc, argv)) {
+        return 1;
+    }
 
+    try {
+        if (!options.lcp_output.empty()) {
+            phases += ",lcp";
+        }
+        if (!options.fm_index_output.empty()) {
+            phases += ",fmindex";
+        }
+        options.phases = parse_phases(phases);
+        if (options.sample_rate == 0) {
+            throw std::invalid_argument("The sample rate must be positive");
+        }
+        options.engine = parse_engine(engine);
+        if (options.format != "binary" && options.format != "text") {
+            throw std::invalid_argument("Unknown output format: " + options.format);
+        }
+        if (options.threads == 0) {
+            throw std::invalid_argument("The number of threads must be positive");
+        }
+        verbosity = options.quiet ? Verbosity::quiet : static_cast<Verbosity>(std::min(level, 3u));
 
-    return 0;
+        if (options.collection) {
+            if (options.factor_file || options.phases.lcp || options.phases.fm_index) {
+                throw std::invalid_argument("--collection cannot be combined with --factors, lcp or fmindex");
+            }
+            double start = tlx::timestamp();
+            Collection collection = build_input_collection(options.input);
+            Factorization factors = factorize_collection(collection);
+            LOGC(log_enabled(Verbosity::phases)) << "ICFL of " << collection.size() << " documents, "
+                                                 << factors.text().size() << " characters: " << factors.size()
+                                                 << " factors in " << tlx::timestamp() - start << " s";
 
-}
\ No newline at end of file
+            //Gli indici dei documenti condividono il tipo delle posizioni
+            std::size_t n = std::max<std::size_t>(factors.text().size(), collection.size());
+            if (n <= max_position<uint32_t>()) {
+                run_collection<uint32_t>(collection, factors, options);
+            } else if (n <= max_position<uint40>()) {
+                run_collection<uint40>(collection, factors, options);
+            } else {
+                run_collection<uint64_t>(collection, factors, options);
+            }
+            return 0;
+        }
+
+        double start = tlx::timestamp();
+        Factorization factors = options.factor_file ? build_input_ICFL(options.input)
+                                                    : factorize_input_text(options.input);
+        LOGC(log_enabled(Verbosity::phases)) << "ICFL of " << factors.text().size() << " characters: "
+                                             << factors.size() << " factors in " << tlx::timestamp() - start << " s";
+        if (log_enabled(Verbosity::nodes)) {
+            std::cout << "ICFL(T) from " << options.input << ": ";
+            print_factorization(factors); std::cout << std::endl;
+        }
+
+        //Posizioni strette quanto la lunghezza del testo consente: 4 byte fino a 4 GiB, 5 byte fino a 1 TiB
+        std::size_t n = factors.text().size();
+        if (n <= max_position<uint32_t>()) {
+            run<uint32_t>(std::move(factors), options);
+        } else if (n <= max_position<uint40>()) {
+            run<uint40>(std::move(factors), options);
+        } else {
+            run<uint64_t>(std::move(factors), options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ICFL: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
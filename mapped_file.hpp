@@ -0,0 +1,130 @@
+#ifndef ICFL_MAPPED_FILE_HPP
+#define ICFL_MAPPED_FILE_HPP
+
+/**
+ * @file mapped_file.hpp
+ * @brief Mappatura in memoria (mmap) di un file in sola lettura.
+ */
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @class MappedFile
+ * @brief File mappato in memoria in sola lettura; la mappatura viene rilasciata dal distruttore.
+ *
+ * Le pagine vengono caricate dal sistema operativo al primo accesso, senza copie nel processo.
+ * Un file vuoto non viene mappato e produce una vista vuota.
+ */
+class MappedFile {
+
+private:
+    const std::byte* _data; ///< Inizio della mappatura (nullptr per un file vuoto).
+    std::size_t _size; ///< Dimensione del file in byte.
+
+public:
+    /**
+     * @brief Mappa il file indicato.
+     * @param filename Percorso del file.
+     * @throw std::runtime_error Se il file non puo' essere aperto o mappato.
+     */
+    explicit MappedFile(const std::string& filename) : _data(nullptr), _size(0) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat file: " + filename);
+        }
+        _size = static_cast<std::size_t>(info.st_size);
+        if (_size > 0) {
+            void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map file: " + filename);
+            }
+            _data = static_cast<const std::byte*>(data);
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Costruttore di spostamento.
+     * @param other File mappato da cui spostare la mappatura.
+     */
+    MappedFile(MappedFile&& other) noexcept
+            : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+    /**
+     * @brief Operatore di assegnamento per spostamento.
+     * @param other File mappato da cui spostare la mappatura.
+     * @return File mappato modificato.
+     */
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Distruttore: rilascia la mappatura.
+     */
+    ~MappedFile() {
+        unmap();
+    }
+
+    /**
+     * @brief Restituisce il contenuto del file.
+     * @return Vista sui byte del file.
+     */
+    std::span<const std::byte> bytes() const {
+        return {_data, _size};
+    }
+
+    /**
+     * @brief Restituisce il contenuto del file come testo.
+     * @return Vista sul contenuto del file.
+     */
+    std::string_view text() const {
+        return {reinterpret_cast<const char*>(_data), _size};
+    }
+
+    /**
+     * @brief Restituisce la dimensione del file.
+     * @return Dimensione in byte.
+     */
+    std::size_t size() const {
+        return _size;
+    }
+
+private:
+    /**
+     * @brief Rilascia la mappatura, se presente.
+     */
+    void unmap() {
+        if (_data != nullptr) {
+            ::munmap(const_cast<std::byte*>(_data), _size);
+            _data = nullptr;
+            _size = 0;
+        }
+    }
+};
+
+#endif //ICFL_MAPPED_FILE_HPP
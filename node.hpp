@@ -3,49 +3,183 @@
 
 #include <pasta/bit_vector/bit_vector.hpp>
 #include <pasta/bit_vector/support/flat_rank_select.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
 #include <utility>
 #include <ostream>
+#include <vector>
+#include "occurrence_set.hpp"
+#include "position.hpp"
 
 /**
- * @class Node
+ * @class BasicNode
  * @brief Rappresenta un nodo in una struttura ad albero.
  *
+ * @tparam Position Tipo delle posizioni nel testo (vedi position.hpp).
+ *
  * La classe Node rappresenta un nodo all'interno di una struttura ad albero.
  * Ogni nodo contiene informazioni sul nodo stesso, come il genitore, i figli, gli indici, la lista g-list,
- * l'insertion target e un puntatore a un oggetto BitVector.
+ * l'insertion target e l'insieme dei fattori in cui occorre il suffisso.
+ * L'insieme e' un BitVector (forma densa) oppure la lista ordinata degli indici dei fattori (forma
+ * sparsa), scelta in base alla densita' quando il nodo viene creato da una lista di fattori: la memoria
+ * dei nodi con poche occorrenze e' cosi' proporzionale alle occorrenze e non al numero di fattori.
+ * La forma densa puo' essere sostituita da un BitVector compresso a blocchi (compress_occurrences()).
+ * Il testo non e' copiato nei nodi: ogni nodo mantiene una vista sul testo posseduto dall'albero.
+ *
+ * Il nodo e' allocator-aware: figli, g-list, BitVector (anche compressi) e relative parole a 64 bit sono
+ * allocati con l'allocatore del nodo. L'albero usa un'arena (std::pmr::monotonic_buffer_resource) condivisa da
+ * tutti i nodi, che viene liberata in un'unica operazione insieme all'albero.
  */
 
-class Node{
+template <typename Position>
+class BasicNode{
+
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>; ///< Allocatore usato dal nodo.
+    using rank_select_type = OccurrenceSet::rank_select_type; ///< Supporto rank/select costruito sul BitVector.
+
+    static_assert(std::uses_allocator_v<pasta::BlockCompressedBitVector, allocator_type>,
+                  "The compressed occurrence sets must be allocated with the node allocator");
 
 private:
-    Node* _parent; ///< Puntatore al nodo genitore.
-    Node* _root; ///< Puntatore al nodo radice.
-    std::string _text; ///< Testo associato al nodo.
-    std::vector<Node*> _children; ///< Vettore di puntatori ai nodi figli.
-    std::pair<unsigned int, unsigned int> _indexes; ///< Coppia di indici che rappresenta l'intervallo associato al suffisso.
-    std::vector<int> _g_list; ///< g-list associata al nodo.
-    unsigned int _insertion_target; ///< Insertion target associato al nodo.
-    pasta::BitVector* _bv; ///< Puntatore a un oggetto BitVector associato al nodo.
+    BasicNode* _parent; ///< Puntatore al nodo genitore.
+    BasicNode* _root; ///< Puntatore al nodo radice.
+    std::string_view _text; ///< Vista sul testo condiviso, posseduto dall'albero.
+    allocator_type _alloc; ///< Allocatore del nodo (l'arena dell'albero).
+    std::pmr::vector<BasicNode*> _children; ///< Vettore di puntatori ai nodi figli.
+    std::pair<Position, Position> _indexes; ///< Coppia di indici che rappresenta l'intervallo associato al suffisso.
+    std::pmr::vector<Position> _g_list; ///< g-list associata al nodo.
+    Position _insertion_target; ///< Insertion target associato al nodo.
+    Position _overlap; ///< Occorrenze del genitore, a partire dall'insertion target, da fondere con la g-list.
+    pasta::BitVector* _bv; ///< Puntatore al BitVector delle occorrenze (forma densa), nullptr nella forma sparsa.
+    mutable rank_select_type* _rs; ///< Supporto rank/select su _bv, costruito al primo utilizzo.
+    pasta::BlockCompressedBitVector* _cbv; ///< Puntatore al BitVector compresso delle occorrenze (forma compressa).
+    std::pmr::vector<uint32_t> _factors; ///< Indici ordinati dei fattori (forma sparsa).
+    std::size_t _factor_count; ///< Numero di fattori, dimensione dell'insieme delle occorrenze.
+
+    /**
+    * @brief Alloca con l'allocatore del nodo un BitVector azzerato e le sue parole.
+    * @param bv_size Dimensione del BitVector.
+    * @return Puntatore al BitVector allocato.
+    */
+    pasta::BitVector* allocate_bv(size_t bv_size) {
+        size_t words = (bv_size >> 6) + 1;
+        uint64_t* data = _alloc.allocate_object<uint64_t>(words);
+        std::fill_n(data, words, 0ULL);
+        return _alloc.new_object<pasta::BitVector>(data, bv_size);
+    }
+
+    /**
+    * @brief Sostituisce il BitVector del nodo con una copia di quello fornito.
+    *
+    * La copia avviene parola per parola (64 bit alla volta) attraverso data().
+    *
+    * @param bv Puntatore al BitVector da copiare, oppure nullptr.
+    */
+    void copy_bv(const pasta::BitVector* bv) {
+        deallocate_rank_select();
+        deallocate_bv();
+        if (bv != nullptr) {
+            _bv = allocate_bv(bv->size());
+            std::span<uint64_t> source = bv->data();
+            std::span<uint64_t> target = _bv->data();
+            std::copy_n(source.begin(), std::min(source.size(), target.size()), target.begin());
+        }
+    }
+
+    /**
+    * @brief Prende il BitVector (e il supporto rank/select) di un altro nodo, se i due allocatori coincidono;
+    * altrimenti lo copia.
+    * @param other Nodo da cui spostare il BitVector.
+    */
+    void move_bv(BasicNode& other) {
+        if (_alloc == other._alloc) {
+            deallocate_rank_select();
+            deallocate_bv();
+            deallocate_cbv();
+            _bv = std::exchange(other._bv, nullptr);
+            _rs = std::exchange(other._rs, nullptr);
+            _cbv = std::exchange(other._cbv, nullptr);
+        } else {
+            copy_bv(other._bv);
+            copy_cbv(other._cbv);
+        }
+    }
+
+    /**
+    * @brief Sostituisce il BitVector compresso del nodo con una copia di quello fornito.
+    *
+    * new_object() costruisce la copia passandole l'allocatore del nodo (uses-allocator construction):
+    * blocchi e parole sono allocati nell'arena come quelli della forma densa.
+    *
+    * @param cbv Puntatore al BitVector compresso da copiare, oppure nullptr.
+    */
+    void copy_cbv(const pasta::BlockCompressedBitVector* cbv) {
+        deallocate_cbv();
+        if (cbv != nullptr) {
+            _cbv = _alloc.new_object<pasta::BlockCompressedBitVector>(*cbv);
+        }
+    }
+
+    /**
+    * @brief Restituisce all'allocatore il BitVector compresso del nodo.
+    */
+    void deallocate_cbv() {
+        if (_cbv != nullptr) {
+            _alloc.delete_object(_cbv);
+            _cbv = nullptr;
+        }
+    }
+
+    /**
+    * @brief Restituisce all'allocatore il supporto rank/select, che dovra' essere ricostruito.
+    */
+    void deallocate_rank_select() {
+        if (_rs != nullptr) {
+            _alloc.delete_object(_rs);
+            _rs = nullptr;
+        }
+    }
+
+    /**
+    * @brief Restituisce all'allocatore il BitVector del nodo e le sue parole.
+    */
+    void deallocate_bv() {
+        if (_bv != nullptr) {
+            std::span<uint64_t> data = _bv->data();
+            _alloc.delete_object(_bv);
+            _alloc.deallocate_object(data.data(), data.size());
+            _bv = nullptr;
+        }
+    }
 
 
 public:
 
     /**
     * @brief Costruttore di default.
+    * @param alloc Allocatore del nodo.
     */
-    Node() : _root(this), _parent(nullptr), _text(), _children(), _indexes(0, 0), _g_list(), _insertion_target(0), _bv(nullptr) {
-        _bv = new pasta::BitVector(1, 0);
+    explicit BasicNode(const allocator_type& alloc = {})
+            : _root(this), _parent(nullptr), _text(), _alloc(alloc), _children(alloc), _indexes(0, 0), _g_list(alloc),
+              _insertion_target(0), _overlap(0), _bv(nullptr), _rs(nullptr), _cbv(nullptr), _factors(alloc), _factor_count(1) {
     }
 
     /**
-    * @brief Costruttore con testo e dimensione del BitVector.
-    * @param text Testo associato al nodo.
-    * @param bv_size Dimensione del BitVector.
+    * @brief Costruttore con testo e numero di fattori: il nodo (la radice) non ha occorrenze.
+    * @param text Vista sul testo associato al nodo; il testo deve sopravvivere al nodo.
+    * @param bv_size Numero di fattori, dimensione dell'insieme delle occorrenze.
+    * @param alloc Allocatore del nodo.
     */
-    Node(const std::string& text, size_t bv_size)
-            : _root(this), _parent(nullptr), _text(text), _children(), _indexes(0, 0), _g_list(), _insertion_target(0) {
-        _bv = new pasta::BitVector(bv_size, 0);
+    BasicNode(std::string_view text, size_t bv_size, const allocator_type& alloc = {})
+            : _root(this), _parent(nullptr), _text(text), _alloc(alloc), _children(alloc), _indexes(0, 0), _g_list(alloc),
+              _insertion_target(0), _overlap(0), _bv(nullptr), _rs(nullptr), _cbv(nullptr), _factors(alloc), _factor_count(bv_size) {
     }
 
     /**
@@ -56,47 +190,72 @@ public:
      * @param indexes Coppia di indici che rappresenta l'intervallo associato al nodo.
      * @param g_list Lista G associata al nodo.
      * @param insertion_target Punto di inserimento associato al nodo.
-     * @param bv Puntatore a un oggetto BitVector associato al nodo.
+     * @param bv Puntatore a un oggetto BitVector associato al nodo, che viene copiato (forma densa).
+     * @param alloc Allocatore del nodo.
      */
-    Node(Node* root, Node* parent, std::vector<Node*> children, std::pair<unsigned int, unsigned int> indexes,
-         std::vector<int> g_list, unsigned int insertion_target, pasta::BitVector *bv):
-
-         _root(root), _parent(parent), _children(std::move(children)), _indexes(std::move(indexes)),
-         _g_list(std::move(g_list)), _insertion_target(insertion_target), _text(root->get_text()){
-
-            if (bv != nullptr) {
-                _bv = new pasta::BitVector(bv->size(), 0);
-                for (unsigned int i = 0; i < bv->size(); ++i) {
-                    (*_bv)[i] = (*bv)[i] ? 1 : 0; // = is assignment operator for bv, not ==
-                }
-            } else {
-                _bv = nullptr;
-            }
+    BasicNode(BasicNode* root, BasicNode* parent, std::span<BasicNode* const> children, std::pair<Position, Position> indexes,
+         std::span<const Position> g_list, Position insertion_target, const pasta::BitVector *bv,
+         const allocator_type& alloc = {}):
+
+         _root(root), _parent(parent), _alloc(alloc), _children(children.begin(), children.end(), alloc),
+         _indexes(std::move(indexes)), _g_list(g_list.begin(), g_list.end(), alloc),
+         _insertion_target(insertion_target), _overlap(0), _text(root->get_text()), _bv(nullptr), _rs(nullptr),
+         _cbv(nullptr), _factors(alloc), _factor_count(bv != nullptr ? bv->size() : 0) {
+
+            copy_bv(bv);
 
          }
 
     /**
-     * @brief Costruttore di copia.
-     * @param other Nodo da cui copiare.
+     * @brief Costruttore a partire dalla lista dei fattori che contengono il suffisso.
+     *
+     * La forma dell'insieme delle occorrenze (BitVector o lista di indici) e' scelta in base alla densita'.
+     *
+     * @param root Puntatore al nodo radice.
+     * @param parent Puntatore al nodo genitore.
+     * @param indexes Coppia di indici che rappresenta l'intervallo associato al nodo.
+     * @param g_list Lista G associata al nodo.
+     * @param insertion_target Punto di inserimento associato al nodo.
+     * @param factors Indici dei fattori che contengono il suffisso, in ordine crescente.
+     * @param factor_count Numero totale di fattori.
+     * @param alloc Allocatore del nodo.
      */
-    Node(const Node& other) : _root(other._root), _parent(other._parent), _children(other._children), _indexes(other._indexes),
-                              _g_list(other._g_list), _insertion_target(other._insertion_target) {
-        if (other._bv) {
-            _bv = new pasta::BitVector(other._bv->size(), false);
-            for (size_t i = 0; i < other._bv->size(); ++i) {
-                (*_bv)[i] = (*other._bv)[i] ? 1 : 0;
-            }
+    BasicNode(BasicNode* root, BasicNode* parent, std::pair<Position, Position> indexes, std::span<const Position> g_list,
+         Position insertion_target, std::span<const uint32_t> factors, std::size_t factor_count,
+         const allocator_type& alloc = {})
+            : _root(root), _parent(parent), _text(root->get_text()), _alloc(alloc), _children(alloc),
+              _indexes(indexes), _g_list(g_list.begin(), g_list.end(), alloc), _insertion_target(insertion_target),
+              _overlap(0), _bv(nullptr), _rs(nullptr), _cbv(nullptr), _factors(alloc), _factor_count(factor_count) {
+        if (prefer_sparse_occurrences(factors.size(), factor_count)) {
+            _factors.assign(factors.begin(), factors.end());
         } else {
-            _bv = nullptr;
+            _bv = allocate_bv(factor_count);
+            for (uint32_t i : factors) {
+                (*_bv)[i] = 1;
+            }
         }
     }
 
+    /**
+     * @brief Costruttore di copia.
+     * @param other Nodo da cui copiare.
+     * @param alloc Allocatore del nuovo nodo.
+     */
+    BasicNode(const BasicNode& other, const allocator_type& alloc = {})
+            : _root(other._root), _parent(other._parent), _text(other._text), _alloc(alloc),
+              _children(other._children, alloc), _indexes(other._indexes), _g_list(other._g_list, alloc),
+              _insertion_target(other._insertion_target), _overlap(other._overlap), _bv(nullptr), _rs(nullptr),
+              _cbv(nullptr), _factors(other._factors, alloc), _factor_count(other._factor_count) {
+        copy_bv(other._bv);
+        copy_cbv(other._cbv);
+    }
+
     /**
     * @brief Operatore di assegnamento.
     * @param other Nodo da cui copiare.
     * @return Nodo modificato.
     */
-    Node& operator=(const Node& other) {
+    BasicNode& operator=(const BasicNode& other) {
         if (this != &other) {
             _root = other._root;
             _parent = other._parent;
@@ -104,16 +263,54 @@ public:
             _indexes = other._indexes;
             _g_list = other._g_list;
             _insertion_target = other._insertion_target;
+            _overlap = other._overlap;
             _text = other._text;
-            delete _bv;
-            if (other._bv) {
-                _bv = new pasta::BitVector(other._bv->size(), false);
-                for (size_t i = 0; i < other._bv->size(); ++i) {
-                    (*_bv)[i] = (*other._bv)[i] ? 1 : 0;
-                }
-            } else {
-                _bv = nullptr;
-            }
+            _factors = other._factors;
+            _factor_count = other._factor_count;
+            copy_bv(other._bv);
+            copy_cbv(other._cbv);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Costruttore di spostamento: il nuovo nodo usa l'allocatore di other e ne prende le risorse.
+     * @param other Nodo da cui spostare.
+     */
+    BasicNode(BasicNode&& other) noexcept : BasicNode(std::move(other), other._alloc) {}
+
+    /**
+     * @brief Costruttore di spostamento con allocatore: se diverso da quello di other, le risorse vengono copiate.
+     * @param other Nodo da cui spostare.
+     * @param alloc Allocatore del nuovo nodo.
+     */
+    BasicNode(BasicNode&& other, const allocator_type& alloc)
+            : _root(other._root), _parent(other._parent), _text(other._text), _alloc(alloc),
+              _children(std::move(other._children), alloc), _indexes(other._indexes),
+              _g_list(std::move(other._g_list), alloc), _insertion_target(other._insertion_target),
+              _overlap(other._overlap), _bv(nullptr), _rs(nullptr), _cbv(nullptr), _factors(std::move(other._factors), alloc),
+              _factor_count(other._factor_count) {
+        move_bv(other);
+    }
+
+    /**
+    * @brief Operatore di assegnamento per spostamento.
+    * @param other Nodo da cui spostare.
+    * @return Nodo modificato.
+    */
+    BasicNode& operator=(BasicNode&& other) {
+        if (this != &other) {
+            _root = other._root;
+            _parent = other._parent;
+            _children = std::move(other._children);
+            _indexes = other._indexes;
+            _g_list = std::move(other._g_list);
+            _insertion_target = other._insertion_target;
+            _overlap = other._overlap;
+            _text = other._text;
+            _factors = std::move(other._factors);
+            _factor_count = other._factor_count;
+            move_bv(other);
         }
         return *this;
     }
@@ -121,47 +318,56 @@ public:
     /**
     * @brief Distruttore della classe Node.
     */
-    ~Node() {
-        delete _bv;
+    ~BasicNode() {
+        deallocate_rank_select();
+        deallocate_bv();
+        deallocate_cbv();
+    }
+
+    /**
+    * @brief Restituisce l'allocatore del nodo.
+    * @return L'allocatore usato per figli, g-list e BitVector.
+    */
+    allocator_type get_allocator() const {
+        return _alloc;
     }
 
     /**
     * @brief Restituisce il puntatore al nodo genitore.
     * @return Puntatore al nodo genitore.
     */
-    Node* get_parent() const {
+    BasicNode* get_parent() const {
         return _parent;
     }
 
     /**
     * @brief Restituisce il suffisso associato al nodo.
-    * @return Il suffisso associato al nodo.
+    * @return Vista sul suffisso associato al nodo, senza copie.
     */
-    std::string get_suffix() const {
+    std::string_view get_suffix() const {
         //std::cout << _indexes.first << " " << _indexes.second << _text.size();
-        if (_indexes == std::make_pair(0, 0)){
+        if (_indexes.first == 0 && _indexes.second == 0){
             return "ROOT";
         }
-        int second = _indexes.second;
-        if (second > _text.size()) {
+        if (_indexes.second > _text.size()) {
             throw std::out_of_range("Index out of range in get_suffix()");
         }
         return _text.substr(_indexes.first, _indexes.second - _indexes.first);
     }
 
     /**
-    * @brief Restituisce il suffisso associato al nodo.
-    * @return Il suffisso associato al nodo.
+    * @brief Restituisce il testo associato al nodo.
+    * @return Vista sul testo condiviso.
     */
-    std::string get_text() const{
+    std::string_view get_text() const{
         return _text;
     }
 
     /**
     * @brief Restituisce i figli del nodo.
-    * @return Vettore di puntatori ai nodi figli.
+    * @return Riferimento costante al vettore di puntatori ai nodi figli.
     */
-    std::vector<Node*> get_children() const {
+    const std::pmr::vector<BasicNode*>& get_children() const {
         return _children;
     }
 
@@ -169,23 +375,49 @@ public:
     * @brief Restituisce l'insertion target del nodo.
     * @return unsigend int rappresentante l'insertion target.
     */
-    unsigned int get_insertion_target() const {
+    Position get_insertion_target() const {
         return _insertion_target;
     }
 
+    /**
+    * @brief Restituisce il numero di occorrenze del genitore da fondere con la g-list del nodo.
+    * @return Numero di elementi della g-list del genitore, a partire dall'insertion target, da fondere.
+    */
+    Position get_overlap() const {
+        return _overlap;
+    }
+
+    /**
+    * @brief Imposta l'insertion target del nodo.
+    * @param insertion_target Insertion target da associare al nodo.
+    * @param overlap Occorrenze del genitore, a partire dall'insertion target, da fondere con la g-list.
+    */
+    void set_insertion_target(Position insertion_target, Position overlap = 0) {
+        _insertion_target = insertion_target;
+        _overlap = overlap;
+    }
+
     /**
     * @brief Restituisce la g-list relativa al nodo.
     * @return Vettore di interi rappresentante la g-list.
     */
-    std::vector<int>& get_g_list(){
+    std::pmr::vector<Position>& get_g_list(){
+        return _g_list;
+    }
+
+    /**
+    * @brief Restituisce la g-list relativa al nodo (versione costante).
+    * @return Vettore di interi rappresentante la g-list.
+    */
+    const std::pmr::vector<Position>& get_g_list() const {
         return _g_list;
     }
 
     /**
     * @brief Imposta il testo associato al nodo e ai suoi figli
-    * @param text Testo da associare al nodo.
+    * @param text Vista sul testo da associare al nodo; il testo deve sopravvivere al nodo.
     */
-    void set_text(const std::string& text) {
+    void set_text(std::string_view text) {
         _text = text;
         for (auto child : _children) {
             if (child) {
@@ -195,18 +427,21 @@ public:
     }
 
     /**
-    * @brief Imposta il BitVector associato al nodo.
+    * @brief Imposta il BitVector associato al nodo, copiandolo con l'allocatore del nodo.
     * @param bv BitVector da associare al nodo.
     */
-    void set_bv(pasta::BitVector &bv){
-        _bv = &bv;
+    void set_bv(const pasta::BitVector &bv){
+        copy_bv(&bv);
+        deallocate_cbv();
+        _factors.clear();
+        _factor_count = bv.size();
     }
 
     /**
     * @brief Imposta il nodo genitore.
     * @param node Puntatore al nodo genitore.
     */
-    void set_parent(Node *node){
+    void set_parent(BasicNode *node){
         _parent = node;
     }
 
@@ -214,8 +449,8 @@ public:
     * @brief Imposta i figli del nodo.
     * @param children Vettore di puntatori ai nodi figli.
     */
-    void set_children(std::vector<Node*> children) {
-        _children = std::move(children);
+    void set_children(std::span<BasicNode* const> children) {
+        _children.assign(children.begin(), children.end());
     }
 
     /**
@@ -224,9 +459,9 @@ public:
     * @param b Puntatore al secondo nodo.
     * @return True se il nodo a deve precedere il nodo b.
     */
-    static bool compare_nodes (Node *a, Node *b){
-        std::string suffix_a = a->get_suffix();
-        std::string suffix_b = b->get_suffix();
+    static bool compare_nodes (BasicNode *a, BasicNode *b){
+        std::string_view suffix_a = a->get_suffix();
+        std::string_view suffix_b = b->get_suffix();
         return suffix_a < suffix_b;
     }
 
@@ -234,25 +469,96 @@ public:
      * @brief Aggiunge un figlio mantenendo l'ordine lessicografico.
      * @param node Puntatore al nodo figlio da aggiungere.
      */
-    void add_child(Node* node) {
+    void add_child(BasicNode* node) {
         _children.push_back(node);
         std::sort(_children.begin(), _children.end(), compare_nodes);
     }
 
     /**
-    * @brief Restituisce il suffisso associato al nodo.
-    * @return Il suffisso associato al nodo.
+    * @brief Restituisce il BitVector delle occorrenze del nodo.
+    * @return Puntatore al BitVector, oppure nullptr se l'insieme e' in forma sparsa o compressa.
     */
     pasta::BitVector* get_bv_pointer() const{
         return _bv;
     }
 
     /**
-    * @brief Stampa il BitVector associato al nodo.
+    * @brief Restituisce il supporto rank/select del BitVector del nodo (solo forma densa).
+    *
+    * La struttura viene costruita con l'allocatore del nodo alla prima chiamata e riutilizzata
+    * nelle successive, finche' il BitVector non viene sostituito. La costruzione pigra non e'
+    * sincronizzata: va effettuata prima di condividere il nodo tra piu' thread.
+    *
+    * @return Riferimento al supporto rank/select.
+    */
+    const rank_select_type& get_rank_select() const {
+        if (_rs == nullptr) {
+            allocator_type alloc = _alloc;
+            _rs = alloc.new_object<rank_select_type>(*_bv);
+        }
+        return *_rs;
+    }
+
+    /**
+    * @brief Restituisce l'insieme dei fattori in cui occorre il suffisso del nodo.
+    *
+    * Per la forma densa costruisce, se necessario, il supporto rank/select (vedi get_rank_select()).
+    *
+    * @return Vista sull'insieme delle occorrenze, valida finche' il nodo non viene modificato.
+    */
+    OccurrenceSet get_occurrences() const {
+        if (_bv != nullptr) {
+            return OccurrenceSet(*_bv, get_rank_select());
+        }
+        if (_cbv != nullptr) {
+            return OccurrenceSet(*_cbv);
+        }
+        return OccurrenceSet(_factor_count, _factors);
+    }
+
+    /**
+    * @brief Sostituisce il BitVector delle occorrenze con la sua versione compressa a blocchi, se occupa meno spazio.
+    *
+    * Pensata per i nodi vicini alla radice, i cui insiemi sono grandi e sbilanciati: la versione compressa
+    * resta in cache pur supportando le interrogazioni rank/select di getInsertionTarget().
+    *
+    * @return true se l'insieme e' stato compresso.
+    */
+    bool compress_occurrences() {
+        if (_bv == nullptr) {
+            return false;
+        }
+        // La prova avviene fuori dall'arena, che non recupererebbe la memoria di una compressione scartata.
+        pasta::BlockCompressedBitVector compressed(*_bv);
+        if (compressed.space_usage() >= _bv->data().size_bytes()) {
+            return false;
+        }
+        deallocate_rank_select();
+        deallocate_bv();
+        // Con un allocatore diverso lo spostamento copia blocchi e parole nell'arena del nodo.
+        _cbv = _alloc.new_object<pasta::BlockCompressedBitVector>(std::move(compressed));
+        return true;
+    }
+
+    /**
+    * @brief Stampa l'insieme delle occorrenze associato al nodo, un bit per fattore.
     */
     void print_bv() {
-        for (auto &it: *_bv) {
-            std::cout << (it ? '1' : '0');
+        if (_bv != nullptr) {
+            for (auto &it: *_bv) {
+                std::cout << (it ? '1' : '0');
+            }
+        } else if (_cbv != nullptr) {
+            for (std::size_t i = 0; i < _cbv->size(); ++i) {
+                std::cout << ((*_cbv)[i] ? '1' : '0');
+            }
+        } else {
+            auto next = _factors.begin();
+            for (std::size_t i = 0; i < _factor_count; ++i) {
+                bool set = next != _factors.end() && *next == i;
+                next += set ? 1 : 0;
+                std::cout << (set ? '1' : '0');
+            }
         }
         std::cout << std::endl;
     }
@@ -272,7 +578,7 @@ public:
     */
     void print_data() {
         std::cout << "-----NODE " << get_suffix() << " -----" << std::endl;
-        if (_indexes == std::make_pair(0, 0)) {
+        if (_indexes == std::make_pair(0u, 0u)) {
             std::cout << "this node is the ROOT" << std::endl;
             return;
         }
@@ -294,11 +600,8 @@ public:
         }
         std::cout << std::endl;
         std::cout << "Insertion target: " << _insertion_target << std::endl;
-        if (_bv) {
-            std::cout << "BitVector: "; print_bv();
-        } else {
-            std::cout << "BitVector: None" << std::endl;
-        }
+        std::cout << "Overlap: " << _overlap << std::endl;
+        std::cout << (_bv ? "BitVector: " : _cbv ? "BitVector (compressed): " : "BitVector (sparse): "); print_bv();
     }
 
     /**
@@ -307,7 +610,7 @@ public:
     * @param node Nodo da stampare.
     * @return Stream di output.
     */
-    friend std::ostream& operator<<(std::ostream& os, const Node& node) {
+    friend std::ostream& operator<<(std::ostream& os, const BasicNode& node) {
         if(node.get_suffix() != ""){
             os << node.get_suffix();
         }
@@ -319,4 +622,7 @@ public:
 
 };
 
+/// Nodo con posizioni a 32 bit, sufficienti per testi fino a 4 GiB.
+using Node = BasicNode<uint32_t>;
+
 #endif //ICFL_NODE_HPP
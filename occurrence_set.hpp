@@ -0,0 +1,143 @@
+#ifndef ICFL_OCCURRENCE_SET_HPP
+#define ICFL_OCCURRENCE_SET_HPP
+
+/**
+ * @file occurrence_set.hpp
+ * @brief Insieme dei fattori in cui occorre il suffisso locale di un nodo, in forma densa, compressa o sparsa.
+ *
+ * La forma densa e' un pasta::BitVector lungo quanto il numero di fattori, con supporto rank/select;
+ * la forma compressa e' un pasta::BlockCompressedBitVector, adatto agli insiemi grandi e sbilanciati
+ * dei nodi vicini alla radice; la forma sparsa e' la lista ordinata degli indici dei fattori, la cui
+ * memoria e' proporzionale al numero di occorrenze. Le operazioni rank1/select1 seguono la semantica di
+ * pasta::FlatRankSelect.
+ */
+
+#include <pasta/bit_vector/bit_vector.hpp>
+#include <pasta/bit_vector/compression/block_compressed_bit_vector.hpp>
+#include <pasta/bit_vector/support/flat_rank_select.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief Indica se conviene la forma sparsa: un indice a 32 bit per occorrenza occupa meno di un bit per fattore.
+ * @param count Numero di fattori che contengono il suffisso.
+ * @param size Numero totale di fattori.
+ * @return true se la lista degli indici e' piu' piccola del BitVector.
+ */
+inline bool prefer_sparse_occurrences(std::size_t count, std::size_t size) {
+    return count * 32 < size;
+}
+
+/**
+ * @class OccurrenceSet
+ * @brief Vista (non proprietaria) sull'insieme delle occorrenze di un nodo, densa, compressa o sparsa.
+ */
+class OccurrenceSet {
+
+public:
+    using rank_select_type = pasta::FlatRankSelect<>; ///< Supporto rank/select della forma densa.
+
+private:
+    std::size_t _size; ///< Numero di fattori (dimensione dell'universo).
+    const pasta::BitVector* _bv; ///< BitVector della forma densa, nullptr nella forma sparsa.
+    const rank_select_type* _rs; ///< Supporto rank/select su _bv.
+    const pasta::BlockCompressedBitVector* _cbv; ///< BitVector compresso, nullptr nelle altre forme.
+    std::span<const uint32_t> _factors; ///< Indici ordinati dei fattori, nella forma sparsa.
+
+public:
+    /**
+     * @brief Costruisce la vista su un insieme denso.
+     * @param bv BitVector delle occorrenze.
+     * @param rs Supporto rank/select costruito su bv.
+     */
+    OccurrenceSet(const pasta::BitVector& bv, const rank_select_type& rs)
+            : _size(bv.size()), _bv(&bv), _rs(&rs), _cbv(nullptr), _factors() {}
+
+    /**
+     * @brief Costruisce la vista su un insieme compresso.
+     * @param cbv BitVector compresso delle occorrenze, con supporto rank/select integrato.
+     */
+    explicit OccurrenceSet(const pasta::BlockCompressedBitVector& cbv)
+            : _size(cbv.size()), _bv(nullptr), _rs(nullptr), _cbv(&cbv), _factors() {}
+
+    /**
+     * @brief Costruisce la vista su un insieme sparso.
+     * @param size Numero di fattori.
+     * @param factors Indici dei fattori che contengono il suffisso, in ordine crescente.
+     */
+    OccurrenceSet(std::size_t size, std::span<const uint32_t> factors)
+            : _size(size), _bv(nullptr), _rs(nullptr), _cbv(nullptr), _factors(factors) {}
+
+    /**
+     * @brief Restituisce il numero di fattori.
+     * @return Dimensione dell'universo.
+     */
+    std::size_t size() const {
+        return _size;
+    }
+
+    /**
+     * @brief Indica se l'insieme e' in forma sparsa.
+     * @return true per la lista di indici, false per il BitVector.
+     */
+    bool is_sparse() const {
+        return _bv == nullptr && _cbv == nullptr;
+    }
+
+    /**
+     * @brief Indica se l'insieme e' in forma compressa.
+     * @return true per il BitVector compresso.
+     */
+    bool is_compressed() const {
+        return _cbv != nullptr;
+    }
+
+    /**
+     * @brief Indica se il fattore i contiene il suffisso.
+     * @param i Indice del fattore.
+     * @return true se il fattore appartiene all'insieme.
+     */
+    bool contains(std::size_t i) const {
+        if (_bv != nullptr) {
+            return (*_bv)[i];
+        }
+        if (_cbv != nullptr) {
+            return (*_cbv)[i];
+        }
+        return std::binary_search(_factors.begin(), _factors.end(), i);
+    }
+
+    /**
+     * @brief Conta i fattori dell'insieme con indice minore di i.
+     * @param i Indice (escluso).
+     * @return Numero di elementi in [0, i).
+     */
+    std::size_t rank1(std::size_t i) const {
+        if (_rs != nullptr) {
+            return _rs->rank1(i);
+        }
+        if (_cbv != nullptr) {
+            return _cbv->rank1(i);
+        }
+        return std::lower_bound(_factors.begin(), _factors.end(), i) - _factors.begin();
+    }
+
+    /**
+     * @brief Restituisce l'indice del rank-esimo fattore dell'insieme.
+     * @param rank Posizione (a partire da 1) dell'elemento cercato.
+     * @return Indice del fattore.
+     */
+    std::size_t select1(std::size_t rank) const {
+        if (_rs != nullptr) {
+            return _rs->select1(rank);
+        }
+        if (_cbv != nullptr) {
+            return _cbv->select1(rank);
+        }
+        return _factors[rank - 1];
+    }
+};
+
+#endif //ICFL_OCCURRENCE_SET_HPP
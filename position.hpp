@@ -0,0 +1,71 @@
+#ifndef ICFL_POSITION_HPP
+#define ICFL_POSITION_HPP
+
+/**
+ * @file position.hpp
+ * @brief Tipi delle posizioni nel testo: uint32_t, uint40 (5 byte) e uint64_t.
+ *
+ * Il tipo delle posizioni e' un parametro di BasicNode, BasicTree e delle funzioni di costruzione:
+ * uint32_t basta per testi fino a 4 GiB, uint40 per testi fino a 1 TiB con 5 byte per posizione,
+ * uint64_t per testi piu' lunghi.
+ */
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * @class uint40
+ * @brief Intero senza segno a 40 bit, memorizzato in 5 byte senza padding.
+ *
+ * Si converte implicitamente da e verso uint64_t, quindi puo' essere usato al posto di un intero nelle
+ * g-list e nel suffix array; i valori oltre 2^40 - 1 vengono troncati.
+ */
+class uint40 {
+
+private:
+    uint32_t _low; ///< 32 bit meno significativi.
+    uint8_t _high; ///< 8 bit piu' significativi.
+
+public:
+    /**
+     * @brief Costruttore di default: zero.
+     */
+    constexpr uint40() : _low(0), _high(0) {}
+
+    /**
+     * @brief Costruttore a partire da un intero.
+     * @param value Valore, minore di 2^40.
+     */
+    constexpr uint40(uint64_t value) : _low(static_cast<uint32_t>(value)), _high(static_cast<uint8_t>(value >> 32)) {}
+
+    /**
+     * @brief Conversione a uint64_t.
+     * @return Valore dell'intero.
+     */
+    constexpr operator uint64_t() const {
+        return (static_cast<uint64_t>(_high) << 32) | _low;
+    }
+} __attribute__((packed));
+
+static_assert(sizeof(uint40) == 5, "uint40 must occupy 5 bytes");
+
+/**
+ * @brief Restituisce il valore massimo rappresentabile da un tipo di posizione.
+ * @tparam Position Tipo della posizione.
+ * @return Massimo valore rappresentabile.
+ */
+template <typename Position>
+constexpr uint64_t max_position() {
+    return std::numeric_limits<Position>::max();
+}
+
+/**
+ * @brief Specializzazione per uint40.
+ * @return 2^40 - 1.
+ */
+template <>
+constexpr uint64_t max_position<uint40>() {
+    return (uint64_t(1) << 40) - 1;
+}
+
+#endif //ICFL_POSITION_HPP
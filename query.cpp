@@ -0,0 +1,195 @@
+/**
+ * @file query.cpp
+ * @brief Interrogazioni in batch su un suffix array: conteggio o localizzazione di un file di pattern.
+ *
+ * Testo, suffix array e pattern sono mappati in memoria. I pattern (uno per riga) sono elaborati a blocchi
+ * di --batch pattern, divisi tra i thread; i risultati di ogni blocco sono scritti nell'ordine dei pattern,
+ * una riga per pattern (il numero di occorrenze, seguito dalle posizioni con --locate). Al termine viene
+ * stampato sullo standard error l'istogramma delle latenze per interrogazione, con intervalli di potenze
+ * di due nanosecondi:
+ *
+ *     LATENCY bucket_ns=<da>-<a> queries=<numero>
+ *     SUMMARY queries=<q> occurrences=<o> threads=<t> time_ms=<ms> queries_per_s=<qps> p50_ns=... p90_ns=...
+ *             p99_ns=... max_ns=...
+ */
+
+#include "func.hpp"
+#include "mapped_file.hpp"
+#include "query.hpp"
+
+#include <tlx/cmdline_parser.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Divide il contenuto di un file in righe, senza copiarle.
+ * @param buffer Contenuto del file.
+ * @return Le righe, senza il carattere di nuova riga; una riga finale vuota viene ignorata.
+ */
+std::vector<std::string_view> split_lines(std::string_view buffer) {
+    std::vector<std::string_view> lines;
+    std::size_t cursor = 0;
+    while (cursor < buffer.size()) {
+        const void* newline = std::memchr(buffer.data() + cursor, '\n', buffer.size() - cursor);
+        std::size_t end = newline ? static_cast<const char*>(newline) - buffer.data() : buffer.size();
+        lines.push_back(buffer.substr(cursor, end - cursor));
+        cursor = end + 1;
+    }
+    return lines;
+}
+
+/**
+ * @brief Restituisce il percentile di un insieme di latenze ordinate.
+ * @param sorted Latenze in ordine crescente, non vuote.
+ * @param percentile Percentile, tra 0 e 100.
+ * @return La latenza al percentile richiesto.
+ */
+uint64_t latency_percentile(const std::vector<uint64_t>& sorted, double percentile) {
+    std::size_t index = static_cast<std::size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char* argv[])
+{
+    std::string text_file;
+    std::string sa_file;
+    std::string pattern_file;
+    std::string output;
+    bool factor_file = false;
+    bool locate = false;
+    bool quiet = false;
+    unsigned int threads = 1;
+    std::size_t batch = 4096;
+    std::size_t limit = 0;
+
+    tlx::CmdlineParser cp;
+    cp.set_description("Counts or locates the patterns of a file (one per line) with a suffix array built by ICFL.");
+    cp.add_param_string("text", text_file, "Indexed text: a raw text, or a factor file with --factors");
+    cp.add_param_string("suffix-array", sa_file, "Binary suffix array file of the text (ICFL --output)");
+    cp.add_param_string("patterns", pattern_file, "Pattern file, one pattern per line");
+    cp.add_flag('f', "factors", factor_file, "The text is a factor file (number of factors, then one factor per line)");
+    cp.add_flag('l', "locate", locate, "Also print the positions of the occurrences");
+    cp.add_size_t('L', "limit", limit, "Maximum number of positions printed per pattern (default: all)");
+    cp.add_string('o', "output", output, "Result file (default: standard output)");
+    cp.add_uint('t', "threads", threads, "Number of threads (default: 1)");
+    cp.add_size_t('b', "batch", batch, "Patterns per batch (default: 4096)");
+    cp.add_flag('q', "quiet", quiet, "Only print the latency histogram and the summary");
+
+    if (!cp.process(argc, argv)) {
+        return 1;
+    }
+
+    try {
+        if (threads == 0 || batch == 0) {
+            throw std::invalid_argument("The number of threads and the batch size must be positive");
+        }
+        // Il testo di un file di fattori e' la concatenazione dei fattori; un testo grezzo resta mappato.
+        Factorization factors;
+        std::unique_ptr<MappedFile> mapped_text;
+        std::string_view text;
+        if (factor_file) {
+            factors = build_input_ICFL(text_file);
+            text = factors.text();
+        } else {
+            mapped_text = std::make_unique<MappedFile>(text_file);
+            text = mapped_text->text();
+        }
+        SuffixArrayQuery engine(text, sa_file);
+        MappedFile patterns_file(pattern_file);
+        std::vector<std::string_view> patterns = split_lines(patterns_file.text());
+
+        std::ofstream file;
+        if (!output.empty()) {
+            file.open(output, std::ios::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("Cannot open file: " + output);
+            }
+        }
+        std::ostream& out = output.empty() ? std::cout : file;
+
+        std::unique_ptr<tlx::ThreadPool> pool;
+        if (threads > 1) {
+            pool = std::make_unique<tlx::ThreadPool>(threads);
+        }
+        const uint64_t max_positions = limit == 0 ? UINT64_MAX : limit;
+        std::vector<uint64_t> latencies(patterns.size());
+        std::vector<uint64_t> counts(std::min(batch, patterns.size()));
+        std::vector<std::vector<uint64_t>> positions(locate ? counts.size() : 0);
+        uint64_t occurrences = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t first = 0; first < patterns.size(); first += batch) {
+            const std::size_t size = std::min(batch, patterns.size() - first);
+            parallel_for(pool.get(), size, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    auto query_start = std::chrono::steady_clock::now();
+                    auto [low, high] = engine.find(patterns[first + i]);
+                    counts[i] = high - low;
+                    if (locate) {
+                        positions[i].clear();
+                        for (uint64_t j = low; j < low + std::min(high - low, max_positions); ++j) {
+                            positions[i].push_back(engine.position(j));
+                        }
+                    }
+                    latencies[first + i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - query_start).count();
+                }
+            });
+            for (std::size_t i = 0; i < size; ++i) {
+                occurrences += counts[i];
+                if (!quiet) {
+                    out << counts[i];
+                    if (locate) {
+                        for (uint64_t position : positions[i]) {
+                            out << ' ' << position;
+                        }
+                    }
+                    out << '\n';
+                }
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Error writing the results");
+        }
+
+        // Istogramma: l'intervallo b contiene le latenze in [2^(b-1), 2^b) nanosecondi.
+        std::array<uint64_t, 65> histogram = {};
+        for (uint64_t latency : latencies) {
+            ++histogram[std::bit_width(latency)];
+        }
+        for (std::size_t b = 0; b < histogram.size(); ++b) {
+            if (histogram[b] > 0) {
+                uint64_t low = b == 0 ? 0 : uint64_t(1) << (b - 1);
+                uint64_t high = b == 0 ? 1 : (b == 64 ? UINT64_MAX : uint64_t(1) << b);
+                std::cerr << "LATENCY bucket_ns=" << low << "-" << high << " queries=" << histogram[b] << std::endl;
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cerr << "SUMMARY queries=" << patterns.size() << " occurrences=" << occurrences
+                  << " threads=" << threads << " time_ms=" << elapsed * 1e3
+                  << " queries_per_s=" << (elapsed > 0 ? patterns.size() / elapsed : 0.0);
+        if (!latencies.empty()) {
+            std::cerr << " p50_ns=" << latency_percentile(latencies, 50)
+                      << " p90_ns=" << latency_percentile(latencies, 90)
+                      << " p99_ns=" << latency_percentile(latencies, 99)
+                      << " max_ns=" << latencies.back();
+        }
+        std::cerr << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "query: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
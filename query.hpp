@@ -0,0 +1,179 @@
+#ifndef ICFL_QUERY_HPP
+#define ICFL_QUERY_HPP
+
+/**
+ * @file query.hpp
+ * @brief Ricerca di pattern su un suffix array letto da file (mmap): conteggio e localizzazione delle occorrenze.
+ *
+ * Le occorrenze di un pattern P sono i suffissi che hanno P come prefisso e occupano un intervallo
+ * contiguo del suffix array, trovato con due ricerche binarie. Le ricerche usano l'accelerazione di
+ * Manber e Myers: mantengono i prefissi comuni l ed r tra P e i suffissi agli estremi dell'intervallo
+ * e confrontano il suffisso centrale a partire da min(l, r) caratteri, che sono certamente uguali.
+ * Non servono strutture oltre al suffix array; nei testi in cui P ha molti prefissi comuni con i suffissi
+ * il costo scende da O(m log n) a circa O(m + log n) confronti.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "suffix_array_io.hpp"
+
+/**
+ * @class SuffixArrayQuery
+ * @brief Motore di ricerca su un testo e sul suo suffix array mappato in memoria.
+ *
+ * Le interrogazioni non modificano lo stato: possono essere eseguite da piu' thread contemporaneamente.
+ */
+class SuffixArrayQuery {
+
+private:
+    std::string_view _text; ///< Testo indicizzato (non posseduto).
+    SuffixArrayFile _sa; ///< Suffix array mappato in memoria.
+
+    /**
+     * @brief Confronta il pattern con un suffisso, saltando i primi skip caratteri gia' noti uguali.
+     * @param position Inizio del suffisso.
+     * @param pattern Pattern.
+     * @param skip Lunghezza di un prefisso comune gia' noto.
+     * @param common Riceve la lunghezza del prefisso comune tra pattern e suffisso.
+     * @return Negativo, zero o positivo se il suffisso e' minore, ha come prefisso il pattern o e' maggiore.
+     */
+    int compare(uint64_t position, std::string_view pattern, std::size_t skip, std::size_t& common) const {
+        const std::size_t available = _text.size() - position;
+        std::size_t i = skip;
+        while (i < pattern.size() && i < available && _text[position + i] == pattern[i]) {
+            ++i;
+        }
+        common = i;
+        if (i == pattern.size()) {
+            return 0;
+        }
+        if (i == available) {
+            return -1; // il suffisso e' un prefisso proprio del pattern
+        }
+        return static_cast<unsigned char>(_text[position + i]) < static_cast<unsigned char>(pattern[i]) ? -1 : 1;
+    }
+
+    /**
+     * @brief Ricerca binaria accelerata del primo suffisso che non precede il pattern (o che lo segue).
+     * @tparam Access Tipo della funzione di accesso al suffix array.
+     * @param pattern Pattern.
+     * @param upper false per il primo suffisso >= P, true per il primo suffisso che non ha P come prefisso
+     *        ed e' maggiore di P.
+     * @param at Funzione che restituisce la posizione i-esima del suffix array.
+     * @return L'indice trovato, tra 0 e n.
+     */
+    template <typename Access>
+    uint64_t bound(std::string_view pattern, bool upper, const Access& at) const {
+        uint64_t low = 0, high = _sa.size(); // la risposta e' in [low, high]
+        std::size_t left = 0, right = 0; // prefissi comuni con i suffissi in low - 1 e in high
+        while (low < high) {
+            uint64_t middle = low + (high - low) / 2;
+            std::size_t common;
+            int order = compare(at(middle), pattern, std::min(left, right), common);
+            if (order < 0 || (upper && order == 0)) {
+                low = middle + 1;
+                left = common;
+            } else {
+                high = middle;
+                right = common;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * @brief Esegue function con l'accesso al suffix array piu' veloce per la dimensione delle posizioni.
+     * @tparam Function Tipo della funzione, invocata con la funzione di accesso.
+     * @param function Funzione da eseguire.
+     * @return Il valore restituito da function.
+     */
+    template <typename Function>
+    auto with_access(const Function& function) const {
+        std::span<const uint32_t> narrow = _sa.entries<uint32_t>();
+        if (!narrow.empty()) {
+            return function([narrow](uint64_t i) -> uint64_t { return narrow[i]; });
+        }
+        std::span<const uint64_t> wide = _sa.entries<uint64_t>();
+        if (!wide.empty()) {
+            return function([wide](uint64_t i) -> uint64_t { return wide[i]; });
+        }
+        return function([this](uint64_t i) -> uint64_t { return _sa[i]; });
+    }
+
+public:
+    /**
+     * @brief Apre il suffix array di un testo.
+     * @param text Testo indicizzato; deve restare valido finche' l'oggetto e' in uso.
+     * @param sa_filename File del suffix array (vedi suffix_array_io.hpp).
+     * @throw std::runtime_error Se il file non e' valido o non corrisponde al testo.
+     */
+    SuffixArrayQuery(std::string_view text, const std::string& sa_filename) : _text(text), _sa(sa_filename) {
+        if (!_sa.matches(_text)) {
+            throw std::runtime_error("The suffix array " + sa_filename + " does not belong to the text");
+        }
+    }
+
+    /**
+     * @brief Restituisce la lunghezza del testo.
+     * @return Numero di caratteri.
+     */
+    uint64_t size() const {
+        return _text.size();
+    }
+
+    /**
+     * @brief Calcola l'intervallo [inizio, fine) del suffix array dei suffissi che hanno pattern come prefisso.
+     * @param pattern Pattern da cercare.
+     * @return L'intervallo, vuoto se il pattern non occorre.
+     */
+    std::pair<uint64_t, uint64_t> find(std::string_view pattern) const {
+        return with_access([&](const auto& at) {
+            uint64_t begin = bound(pattern, false, at);
+            uint64_t end = bound(pattern, true, at);
+            return std::make_pair(begin, std::max(begin, end));
+        });
+    }
+
+    /**
+     * @brief Conta le occorrenze di un pattern nel testo.
+     * @param pattern Pattern da cercare.
+     * @return Numero di occorrenze.
+     */
+    uint64_t count(std::string_view pattern) const {
+        auto [begin, end] = find(pattern);
+        return end - begin;
+    }
+
+    /**
+     * @brief Restituisce la posizione i-esima del suffix array.
+     * @param i Indice nel suffix array, ad esempio all'interno dell'intervallo restituito da find().
+     * @return La posizione del suffisso.
+     */
+    uint64_t position(uint64_t i) const {
+        return _sa[i];
+    }
+
+    /**
+     * @brief Restituisce le posizioni delle occorrenze di un pattern, nell'ordine del suffix array.
+     * @param pattern Pattern da cercare.
+     * @param limit Numero massimo di posizioni restituite.
+     * @return Le posizioni delle occorrenze (al piu' limit).
+     */
+    std::vector<uint64_t> locate(std::string_view pattern, uint64_t limit = UINT64_MAX) const {
+        auto [begin, end] = find(pattern);
+        end = begin + std::min(end - begin, limit);
+        std::vector<uint64_t> positions;
+        positions.reserve(end - begin);
+        for (uint64_t i = begin; i < end; ++i) {
+            positions.push_back(position(i));
+        }
+        return positions;
+    }
+};
+
+#endif //ICFL_QUERY_HPP
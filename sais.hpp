@@ -0,0 +1,194 @@
+#ifndef ICFL_SAIS_HPP
+#define ICFL_SAIS_HPP
+
+/**
+ * @file sais.hpp
+ * @brief Costruzione del suffix array in tempo lineare con SA-IS (Nong, Zhang e Chan, 2009).
+ *
+ * E' indipendente dalla fattorizzazione: serve come motore alternativo al prefix tree, quando la ICFL
+ * ha pochi fattori molto lunghi, e come riferimento per le verifiche e i benchmark.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "position.hpp"
+
+/**
+ * @brief Calcola il suffix array di una sequenza di simboli interi con SA-IS.
+ *
+ * I suffissi LMS vengono ordinati per induzione, rinominati e, se non sono tutti distinti, ordinati
+ * ricorsivamente sulla sequenza dei nomi (lunga al piu' n / 2); un'ultima induzione ordina tutti i suffissi.
+ * La memoria aggiuntiva e' di circa 2n indici e n bit, piu' quella della ricorsione.
+ *
+ * @tparam Index Tipo intero degli indici, capace di rappresentare n.
+ * @tparam Symbol Tipo dei simboli.
+ * @param s Sequenza di simboli.
+ * @param upper Valore massimo di un simbolo.
+ * @return Il suffix array di s.
+ */
+template <typename Index, typename Symbol>
+std::vector<Index> sais(std::span<const Symbol> s, Index upper) {
+    constexpr Index EMPTY = std::numeric_limits<Index>::max();
+    const Index n = s.size();
+    if (n == 0) {
+        return {};
+    }
+    if (n == 1) {
+        return {0};
+    }
+    if (n == 2) {
+        return s[0] < s[1] ? std::vector<Index>{0, 1} : std::vector<Index>{1, 0};
+    }
+
+    // Tipo dei suffissi: true per S (minore del successivo), false per L.
+    std::vector<Index> sa(n);
+    std::vector<bool> ls(n, false);
+    for (Index i = n - 1; i-- > 0; ) {
+        ls[i] = s[i] == s[i + 1] ? ls[i + 1] : s[i] < s[i + 1];
+    }
+
+    // Inizio dei bucket L e dei bucket S di ogni simbolo.
+    std::vector<Index> sum_l(upper + 2, 0), sum_s(upper + 2, 0);
+    for (Index i = 0; i < n; ++i) {
+        if (!ls[i]) {
+            ++sum_s[s[i]];
+        } else {
+            ++sum_l[s[i] + 1];
+        }
+    }
+    for (Index c = 0; c <= upper; ++c) {
+        sum_s[c] += sum_l[c];
+        sum_l[c + 1] += sum_s[c];
+    }
+
+    // Ordina tutti i suffissi per induzione a partire dai suffissi LMS in lms, nell'ordine dato.
+    std::vector<Index> buffer(upper + 2);
+    auto induce = [&](const std::vector<Index>& lms) {
+        std::fill(sa.begin(), sa.end(), EMPTY);
+        std::copy(sum_s.begin(), sum_s.end(), buffer.begin());
+        for (Index d : lms) {
+            sa[buffer[s[d]]++] = d;
+        }
+        std::copy(sum_l.begin(), sum_l.end(), buffer.begin());
+        sa[buffer[s[n - 1]]++] = n - 1;
+        for (Index i = 0; i < n; ++i) {
+            Index v = sa[i];
+            if (v != EMPTY && v >= 1 && !ls[v - 1]) {
+                sa[buffer[s[v - 1]]++] = v - 1;
+            }
+        }
+        std::copy(sum_l.begin(), sum_l.end(), buffer.begin());
+        for (Index i = n; i-- > 0; ) {
+            Index v = sa[i];
+            if (v != EMPTY && v >= 1 && ls[v - 1]) {
+                sa[--buffer[s[v - 1] + 1]] = v - 1;
+            }
+        }
+    };
+
+    // Suffissi LMS (S preceduti da L), in ordine di posizione, e loro indice.
+    std::vector<Index> lms_map(std::size_t(n) + 1, EMPTY);
+    std::vector<Index> lms;
+    for (Index i = 1; i < n; ++i) {
+        if (!ls[i - 1] && ls[i]) {
+            lms_map[i] = lms.size();
+            lms.push_back(i);
+        }
+    }
+    const Index m = lms.size();
+
+    induce(lms);
+
+    if (m > 0) {
+        std::vector<Index> sorted_lms;
+        sorted_lms.reserve(m);
+        for (Index v : sa) {
+            if (lms_map[v] != EMPTY) {
+                sorted_lms.push_back(v);
+            }
+        }
+
+        // Nomi delle sottostringhe LMS: uguali se le sottostringhe coincidono.
+        std::vector<Index> names(m);
+        Index name = 0;
+        names[lms_map[sorted_lms[0]]] = 0;
+        for (Index i = 1; i < m; ++i) {
+            Index l = sorted_lms[i - 1], r = sorted_lms[i];
+            Index end_l = lms_map[l] + 1 < m ? lms[lms_map[l] + 1] : n;
+            Index end_r = lms_map[r] + 1 < m ? lms[lms_map[r] + 1] : n;
+            bool same = true;
+            if (end_l - l != end_r - r) {
+                same = false;
+            } else {
+                while (l < end_l && s[l] == s[r]) {
+                    ++l;
+                    ++r;
+                }
+                if (l == n || s[l] != s[r]) {
+                    same = false;
+                }
+            }
+            if (!same) {
+                ++name;
+            }
+            names[lms_map[sorted_lms[i]]] = name;
+        }
+        lms_map = std::vector<Index>();
+
+        std::vector<Index> names_sa = sais<Index, Index>(std::span<const Index>(names), name);
+        for (Index i = 0; i < m; ++i) {
+            sorted_lms[i] = lms[names_sa[i]];
+        }
+        induce(sorted_lms);
+    }
+    return sa;
+}
+
+/**
+ * @brief Calcola il suffix array di un testo con SA-IS, senza usare la fattorizzazione.
+ *
+ * Gli indici interni sono a 32 bit se bastano per il testo, altrimenti a 64 bit.
+ *
+ * @tparam Position Tipo delle posizioni del suffix array restituito.
+ * @param text Testo; i caratteri sono confrontati come unsigned char, coerentemente con std::string.
+ * @return Il suffix array del testo.
+ */
+template <typename Position = uint32_t>
+std::vector<Position> build_suffix_array_sais(std::string_view text) {
+    using Index = std::conditional_t<sizeof(Position) <= sizeof(uint32_t), uint32_t, uint64_t>;
+    std::span<const unsigned char> symbols(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+    std::vector<Index> sa = sais<Index, unsigned char>(symbols, std::numeric_limits<unsigned char>::max());
+    if constexpr (std::is_same_v<Index, Position>) {
+        return sa;
+    } else {
+        return std::vector<Position>(sa.begin(), sa.end());
+    }
+}
+
+/**
+ * @brief Stima per difetto la memoria necessaria a build_suffix_array_sais() per un testo di lunghezza n.
+ *
+ * Conta il testo, il suffix array e gli indici LMS del primo livello (al piu' n / 2, nella mappa e nei nomi),
+ * piu' la copia del risultato se Position e gli indici interni hanno dimensioni diverse.
+ *
+ * @tparam Position Tipo delle posizioni del suffix array.
+ * @param n Lunghezza del testo.
+ * @return Numero minimo di byte richiesti dalla costruzione.
+ */
+template <typename Position = uint32_t>
+uint64_t estimate_sais_memory(uint64_t n) {
+    using Index = std::conditional_t<sizeof(Position) <= sizeof(uint32_t), uint32_t, uint64_t>;
+    uint64_t memory = n + n * sizeof(Index) + n * sizeof(Index) + n / 8;
+    if constexpr (!std::is_same_v<Index, Position>) {
+        memory += n * sizeof(Position);
+    }
+    return memory;
+}
+
+#endif //ICFL_SAIS_HPP
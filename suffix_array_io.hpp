@@ -0,0 +1,321 @@
+#ifndef ICFL_SUFFIX_ARRAY_IO_HPP
+#define ICFL_SUFFIX_ARRAY_IO_HPP
+
+/**
+ * @file suffix_array_io.hpp
+ * @brief Scrittura e lettura (tramite mmap) del suffix array e dell'array LCP in formato binario.
+ *
+ * Il file e' formato da un'intestazione di 64 byte seguita dalle n posizioni del suffix array, ognuna
+ * memorizzata little-endian su 4, 5 o 8 byte, senza padding. Tutti i campi dell'intestazione sono
+ * little-endian:
+ *
+ * | offset | byte | campo                                                       |
+ * |--------|------|-------------------------------------------------------------|
+ * | 0      | 8    | magic "ICFLSA\0\0" (suffix array) o "ICFLLCP\0" (array LCP)   |
+ * | 8      | 4    | versione del formato (1)                                    |
+ * | 12     | 4    | byte per posizione (4, 5 o 8)                               |
+ * | 16     | 8    | lunghezza del testo (= numero di posizioni)                 |
+ * | 24     | 8    | checksum del testo (fingerprint di Karp-Rabin, text_fingerprint()) |
+ * | 32     | 8    | identificativo della fattorizzazione (factorization_id())   |
+ * | 40     | 24   | riservati (zero)                                            |
+ *
+ * L'array LCP usa lo stesso formato: i suoi valori, minori della lunghezza del testo, occupano gli stessi byte
+ * delle posizioni del suffix array. Anche il suffix array generalizzato di una collezione (collection.hpp) usa
+ * lo stesso formato, con magic "ICFLGSA\0": le posizioni sono quelle della concatenazione dei documenti,
+ * ordinate come se ogni documento fosse seguito dal proprio separatore, quindi il file non e' un suffix array
+ * della concatenazione e ha un magic distinto.
+ *
+ * Con 8 byte per posizione su un sistema little-endian le posizioni sono allineate e possono essere lette
+ * direttamente come uint64_t dalla mappatura (analogamente con 4 byte e uint32_t).
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "factorization.hpp"
+#include "fingerprint.hpp"
+#include "mapped_file.hpp"
+
+constexpr std::array<char, 8> SUFFIX_ARRAY_MAGIC = {'I', 'C', 'F', 'L', 'S', 'A', '\0', '\0'}; ///< Magic del formato.
+constexpr std::array<char, 8> LCP_ARRAY_MAGIC = {'I', 'C', 'F', 'L', 'L', 'C', 'P', '\0'}; ///< Magic dei file LCP.
+constexpr std::array<char, 8> GENERALIZED_SUFFIX_ARRAY_MAGIC = {'I', 'C', 'F', 'L', 'G', 'S', 'A', '\0'}; ///< Magic dei suffix array generalizzati.
+constexpr uint32_t SUFFIX_ARRAY_VERSION = 1; ///< Versione del formato.
+constexpr std::size_t SUFFIX_ARRAY_HEADER_SIZE = 64; ///< Dimensione dell'intestazione in byte.
+
+/**
+ * @brief Intestazione di un file di suffix array.
+ */
+struct SuffixArrayHeader {
+    uint32_t version; ///< Versione del formato.
+    uint32_t entry_bytes; ///< Byte per posizione (4, 5 o 8).
+    uint64_t text_length; ///< Lunghezza del testo, uguale al numero di posizioni.
+    uint64_t checksum; ///< Fingerprint del testo.
+    uint64_t factorization_id; ///< Identificativo della fattorizzazione da cui e' stato costruito il suffix array.
+};
+
+/**
+ * @brief Calcola l'identificativo di una fattorizzazione: il fingerprint della sequenza degli offset dei fattori.
+ * @param factorization Fattorizzazione.
+ * @return Identificativo della fattorizzazione.
+ */
+inline uint64_t factorization_id(const Factorization& factorization) {
+    uint64_t id = 0;
+    for (uint64_t start : factorization.starts()) {
+        id = fingerprint_append(id, start);
+    }
+    return id;
+}
+
+/**
+ * @brief Restituisce il numero minimo di byte per posizione (4, 5 o 8) sufficiente per un testo.
+ * @param text_length Lunghezza del testo.
+ * @return Byte per posizione.
+ */
+inline uint32_t suffix_array_entry_bytes(uint64_t text_length) {
+    if (text_length <= (uint64_t(1) << 32)) {
+        return 4;
+    }
+    if (text_length <= (uint64_t(1) << 40)) {
+        return 5;
+    }
+    return 8;
+}
+
+/**
+ * @brief Scrive value little-endian sui primi bytes byte di out.
+ * @param out Destinazione.
+ * @param value Valore da scrivere.
+ * @param bytes Numero di byte.
+ */
+inline void store_little_endian(char* out, uint64_t value, std::size_t bytes) {
+    for (std::size_t b = 0; b < bytes; ++b) {
+        out[b] = static_cast<char>(value >> (8 * b));
+    }
+}
+
+/**
+ * @brief Legge un valore little-endian di bytes byte.
+ * @param in Sorgente.
+ * @param bytes Numero di byte.
+ * @return Valore letto.
+ */
+inline uint64_t load_little_endian(const std::byte* in, std::size_t bytes) {
+    uint64_t value = 0;
+    for (std::size_t b = 0; b < bytes; ++b) {
+        value |= static_cast<uint64_t>(in[b]) << (8 * b);
+    }
+    return value;
+}
+
+/**
+ * @brief Scrive un array di n valori in un file binario (vedi il formato descritto in suffix_array_io.hpp).
+ *
+ * @tparam Position Tipo dei valori.
+ * @param filename Percorso del file da scrivere.
+ * @param sa Valori da scrivere: il suffix array o l'array LCP del testo della fattorizzazione.
+ * @param factorization Fattorizzazione da cui e' stato costruito il suffix array.
+ * @param entry_bytes Byte per valore (4, 5 o 8); 0 per scegliere il minimo sufficiente.
+ * @param magic Magic del file: SUFFIX_ARRAY_MAGIC, LCP_ARRAY_MAGIC o GENERALIZED_SUFFIX_ARRAY_MAGIC.
+ * @throw std::invalid_argument Se la dimensione richiesta non e' valida o non basta per il testo.
+ * @throw std::runtime_error Se il file non puo' essere scritto.
+ */
+template <typename Position>
+void write_position_file(const std::string& filename, std::span<const Position> sa,
+                         const Factorization& factorization, uint32_t entry_bytes,
+                         const std::array<char, 8>& magic) {
+    const uint64_t n = factorization.text().size();
+    if (sa.size() != n) {
+        throw std::invalid_argument("Suffix array and text lengths differ");
+    }
+    if (entry_bytes == 0) {
+        entry_bytes = suffix_array_entry_bytes(n);
+    }
+    if (entry_bytes != 4 && entry_bytes != 5 && entry_bytes != 8) {
+        throw std::invalid_argument("Invalid suffix array entry size: " + std::to_string(entry_bytes));
+    }
+    if (entry_bytes < suffix_array_entry_bytes(n)) {
+        throw std::invalid_argument("Suffix array entry size too small for the text");
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    char header[SUFFIX_ARRAY_HEADER_SIZE] = {};
+    std::copy(magic.begin(), magic.end(), header);
+    store_little_endian(header + 8, SUFFIX_ARRAY_VERSION, 4);
+    store_little_endian(header + 12, entry_bytes, 4);
+    store_little_endian(header + 16, n, 8);
+    store_little_endian(header + 24, text_fingerprint(factorization.text()), 8);
+    store_little_endian(header + 32, factorization_id(factorization), 8);
+    file.write(header, SUFFIX_ARRAY_HEADER_SIZE);
+
+    // Scrittura a blocchi per non eseguire una chiamata per posizione.
+    constexpr std::size_t BLOCK_ENTRIES = 1 << 16;
+    std::vector<char> buffer(BLOCK_ENTRIES * entry_bytes);
+    for (std::size_t begin = 0; begin < sa.size(); begin += BLOCK_ENTRIES) {
+        std::size_t end = std::min(sa.size(), begin + BLOCK_ENTRIES);
+        for (std::size_t i = begin; i < end; ++i) {
+            store_little_endian(buffer.data() + (i - begin) * entry_bytes, static_cast<uint64_t>(sa[i]), entry_bytes);
+        }
+        file.write(buffer.data(), (end - begin) * entry_bytes);
+    }
+
+    if (!file) {
+        throw std::runtime_error("Error writing file: " + filename);
+    }
+}
+
+/**
+ * @brief Scrive il suffix array in un file binario (vedi il formato descritto in suffix_array_io.hpp).
+ *
+ * @tparam Position Tipo delle posizioni del suffix array.
+ * @param filename Percorso del file da scrivere.
+ * @param sa Suffix array del testo della fattorizzazione.
+ * @param factorization Fattorizzazione da cui e' stato costruito il suffix array.
+ * @param entry_bytes Byte per posizione (4, 5 o 8); 0 per scegliere il minimo sufficiente.
+ * @throw std::invalid_argument Se la dimensione richiesta non e' valida o non basta per il testo.
+ * @throw std::runtime_error Se il file non puo' essere scritto.
+ */
+template <typename Position>
+void write_suffix_array(const std::string& filename, std::span<const Position> sa,
+                        const Factorization& factorization, uint32_t entry_bytes = 0) {
+    write_position_file<Position>(filename, sa, factorization, entry_bytes, SUFFIX_ARRAY_MAGIC);
+}
+
+/**
+ * @brief Scrive l'array LCP in un file binario, nello stesso formato del suffix array con magic "ICFLLCP".
+ *
+ * @tparam Position Tipo dei valori LCP.
+ * @param filename Percorso del file da scrivere.
+ * @param lcp Array LCP del testo della fattorizzazione (vedi build_lcp_array()).
+ * @param factorization Fattorizzazione da cui e' stato costruito il suffix array.
+ * @param entry_bytes Byte per valore (4, 5 o 8); 0 per scegliere il minimo sufficiente.
+ * @throw std::invalid_argument Se la dimensione richiesta non e' valida o non basta per il testo.
+ * @throw std::runtime_error Se il file non puo' essere scritto.
+ */
+template <typename Position>
+void write_lcp_array(const std::string& filename, std::span<const Position> lcp,
+                     const Factorization& factorization, uint32_t entry_bytes = 0) {
+    write_position_file<Position>(filename, lcp, factorization, entry_bytes, LCP_ARRAY_MAGIC);
+}
+
+/**
+ * @brief Scrive il suffix array generalizzato di una collezione in un file binario, nello stesso formato del
+ * suffix array con magic "ICFLGSA".
+ *
+ * @tparam Position Tipo delle posizioni.
+ * @param filename Percorso del file da scrivere.
+ * @param gsa Suffix array generalizzato, come posizioni della concatenazione dei documenti.
+ * @param factorization Fattorizzazione della concatenazione, con i fattori di ogni documento (factorize_collection()).
+ * @param entry_bytes Byte per posizione (4, 5 o 8); 0 per scegliere il minimo sufficiente.
+ * @throw std::invalid_argument Se la dimensione richiesta non e' valida o non basta per il testo.
+ * @throw std::runtime_error Se il file non puo' essere scritto.
+ */
+template <typename Position>
+void write_generalized_suffix_array(const std::string& filename, std::span<const Position> gsa,
+                                    const Factorization& factorization, uint32_t entry_bytes = 0) {
+    write_position_file<Position>(filename, gsa, factorization, entry_bytes, GENERALIZED_SUFFIX_ARRAY_MAGIC);
+}
+
+/**
+ * @class SuffixArrayFile
+ * @brief Suffix array (o array LCP) letto da file tramite mmap, senza copie.
+ */
+class SuffixArrayFile {
+
+private:
+    MappedFile _file; ///< File mappato in memoria.
+    SuffixArrayHeader _header; ///< Intestazione decodificata.
+    const std::byte* _entries; ///< Inizio delle posizioni nella mappatura.
+
+public:
+    /**
+     * @brief Mappa il file e ne valida l'intestazione.
+     * @param filename Percorso del file.
+     * @param magic Magic atteso: SUFFIX_ARRAY_MAGIC, LCP_ARRAY_MAGIC per un array LCP o
+     *        GENERALIZED_SUFFIX_ARRAY_MAGIC per un suffix array generalizzato.
+     * @throw std::runtime_error Se il file non puo' essere letto o non e' un suffix array valido.
+     */
+    explicit SuffixArrayFile(const std::string& filename, const std::array<char, 8>& magic = SUFFIX_ARRAY_MAGIC)
+            : _file(filename), _header(), _entries(nullptr) {
+        std::span<const std::byte> bytes = _file.bytes();
+        if (bytes.size() < SUFFIX_ARRAY_HEADER_SIZE ||
+            std::memcmp(bytes.data(), magic.data(), magic.size()) != 0) {
+            throw std::runtime_error("Not a suffix array file: " + filename);
+        }
+        _header.version = load_little_endian(bytes.data() + 8, 4);
+        _header.entry_bytes = load_little_endian(bytes.data() + 12, 4);
+        _header.text_length = load_little_endian(bytes.data() + 16, 8);
+        _header.checksum = load_little_endian(bytes.data() + 24, 8);
+        _header.factorization_id = load_little_endian(bytes.data() + 32, 8);
+        if (_header.version != SUFFIX_ARRAY_VERSION) {
+            throw std::runtime_error("Unsupported suffix array version in: " + filename);
+        }
+        if (_header.entry_bytes != 4 && _header.entry_bytes != 5 && _header.entry_bytes != 8) {
+            throw std::runtime_error("Invalid suffix array entry size in: " + filename);
+        }
+        if ((bytes.size() - SUFFIX_ARRAY_HEADER_SIZE) / _header.entry_bytes != _header.text_length ||
+            (bytes.size() - SUFFIX_ARRAY_HEADER_SIZE) % _header.entry_bytes != 0) {
+            throw std::runtime_error("Truncated suffix array file: " + filename);
+        }
+        _entries = bytes.data() + SUFFIX_ARRAY_HEADER_SIZE;
+    }
+
+    /**
+     * @brief Restituisce l'intestazione del file.
+     * @return Intestazione decodificata.
+     */
+    const SuffixArrayHeader& header() const {
+        return _header;
+    }
+
+    /**
+     * @brief Restituisce il numero di posizioni.
+     * @return Lunghezza del suffix array.
+     */
+    std::size_t size() const {
+        return _header.text_length;
+    }
+
+    /**
+     * @brief Restituisce la posizione i-esima del suffix array.
+     * @param i Indice nel suffix array.
+     * @return Posizione nel testo dell'i-esimo suffisso in ordine lessicografico.
+     */
+    uint64_t operator[](std::size_t i) const {
+        return load_little_endian(_entries + i * _header.entry_bytes, _header.entry_bytes);
+    }
+
+    /**
+     * @brief Restituisce le posizioni direttamente come array di T, se la loro rappresentazione coincide.
+     * @tparam T uint32_t (posizioni a 4 byte) o uint64_t (posizioni a 8 byte).
+     * @return Vista sulle posizioni nella mappatura, oppure una vista vuota se il formato non coincide.
+     */
+    template <typename T>
+    std::span<const T> entries() const {
+        if (sizeof(T) != _header.entry_bytes || std::endian::native != std::endian::little) {
+            return {};
+        }
+        return {reinterpret_cast<const T*>(_entries), size()};
+    }
+
+    /**
+     * @brief Verifica che il suffix array corrisponda al testo dato (lunghezza e checksum).
+     * @param text Testo.
+     * @return true se lunghezza e checksum coincidono.
+     */
+    bool matches(std::string_view text) const {
+        return text.size() == _header.text_length && text_fingerprint(text) == _header.checksum;
+    }
+};
+
+#endif //ICFL_SUFFIX_ARRAY_IO_HPP
@@ -3,80 +3,168 @@
 
 #include <pasta/bit_vector/bit_vector.hpp>
 #include <pasta/bit_vector/support/flat_rank_select.hpp>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <vector>
 #include "node.hpp"
+#include "factorization.hpp"
 
 /**
- * @class Tree
- * @brief La classe Tree rappresenta una struttura ad albero con nodi di tipo Node.
+ * @class BasicTree
+ * @brief La classe BasicTree rappresenta una struttura ad albero con nodi di tipo BasicNode.
  *
- * Questa classe gestisce un albero con radice _root e mantiene una lista di stringhe
- * chiamata _icfl (Inverse Lyndon Factorization)
+ * Questa classe gestisce un albero con radice _root e mantiene la fattorizzazione
+ * _icfl (Inverse Lyndon Factorization) del testo.
+ * L'albero possiede la fattorizzazione, e con essa il testo se non e' una vista (Factorization::view()):
+ * i nodi ne mantengono soltanto una vista. Per questo la fattorizzazione e' allocata dinamicamente e
+ * l'albero puo' essere spostato ma non copiato.
+ *
+ * Tutti i nodi, con i rispettivi figli, g-list e BitVector, sono allocati in un'arena posseduta
+ * dall'albero: la memoria viene liberata in blocco alla distruzione dell'albero.
+ *
+ * @tparam Position Tipo delle posizioni nel testo (vedi position.hpp).
  */
-class Tree {
+template <typename Position>
+class BasicTree {
+
+public:
+    using node_type = BasicNode<Position>; ///< Tipo dei nodi dell'albero.
 
 private:
-    Node* _root;  ///< Puntatore al nodo radice dell'albero.
-    std::list<std::string> _icfl;  ///< Lista di stringhe rappresentante l'ICFL.
+    node_type* _root;  ///< Puntatore al nodo radice dell'albero.
+    std::unique_ptr<Factorization> _icfl;  ///< Fattorizzazione ICFL del testo, a indirizzo stabile.
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> _arena;  ///< Arena in cui sono allocati i nodi.
+
+    /**
+     * @brief Distrugge tutti i nodi dell'albero.
+     *
+     * La visita e' iterativa per non dipendere dalla profondita' dell'albero. La memoria dei nodi
+     * resta all'arena, che la rilascia quando viene distrutta.
+     */
+    void destroy_nodes() {
+        if (_root == nullptr) {
+            return;
+        }
+        typename node_type::allocator_type alloc(_arena.get());
+        std::vector<node_type*> stack{_root};
+        while (!stack.empty()) {
+            node_type* node = stack.back();
+            stack.pop_back();
+            stack.insert(stack.end(), node->get_children().begin(), node->get_children().end());
+            alloc.delete_object(node);
+        }
+        _root = nullptr;
+    }
 
 public:
     /**
-     * @brief Costruttore della classe Tree.
+     * @brief Costruttore della classe BasicTree.
      *
-     * Costruisce un oggetto Tree con la lista ICFL fornita. Inizializza il nodo _root
-     * con il testo concatenato dell'ICFL e la dimensione della lista ICFL.
+     * Costruisce un oggetto BasicTree con la fattorizzazione ICFL fornita. Inizializza il nodo _root
+     * con una vista sul testo dell'ICFL e il numero di fattori.
      *
-     * @param icfl Lista di stringhe che rappresentano l'ICFL.
+     * @param icfl Fattorizzazione ICFL del testo; viene spostata all'interno dell'albero.
      */
-    Tree(const std::list<std::string> &icfl) : _icfl(icfl) {
-        std::string text;
-        for (const std::string& factor : icfl) {
-            text += factor;
-        }
-        _root = new Node(text, icfl.size());
+    BasicTree(Factorization icfl) : _icfl(std::make_unique<Factorization>(std::move(icfl))),
+                               _arena(std::make_unique<std::pmr::monotonic_buffer_resource>()) {
+        _root = get_allocator().template new_object<node_type>(_icfl->text(), _icfl->size());
     }
 
+    BasicTree(const BasicTree&) = delete;
+    BasicTree& operator=(const BasicTree&) = delete;
+
     /**
-     * @brief Distruttore della classe Tree.
+     * @brief Costruttore di spostamento: i nodi continuano a riferirsi allo stesso testo.
+     * @param other Albero da cui spostare.
+     */
+    BasicTree(BasicTree&& other) noexcept : _root(other._root), _icfl(std::move(other._icfl)), _arena(std::move(other._arena)) {
+        other._root = nullptr;
+    }
+
+    /**
+     * @brief Distruttore della classe BasicTree.
      *
-     * Distrugge l'oggetto Tree e dealloca la memoria del nodo radice.
+     * Distrugge tutti i nodi dell'albero e rilascia in blocco l'arena che li contiene.
      */
-    ~Tree() {
-        delete _root;
+    ~BasicTree() {
+        destroy_nodes();
     }
 
     /**
-     * @brief Restituisce la lista ICFL.
+     * @brief Restituisce l'allocatore dell'arena dell'albero.
+     * @return Allocatore con cui vengono creati i nodi.
+     */
+    typename node_type::allocator_type get_allocator() const {
+        return typename node_type::allocator_type(_arena.get());
+    }
+
+    /**
+     * @brief Crea un nuovo nodo nell'arena dell'albero.
+     *
+     * Il nodo non viene collegato al genitore: e' compito del chiamante aggiungerlo ai suoi figli.
+     *
+     * @param parent Puntatore al nodo genitore.
+     * @param indexes Coppia di indici che rappresenta l'intervallo associato al nodo.
+     * @param g_list Lista G associata al nodo.
+     * @param insertion_target Punto di inserimento associato al nodo.
+     * @param bv Puntatore al BitVector associato al nodo, che viene copiato.
+     * @return Puntatore al nodo creato.
+     */
+    node_type* create_node(node_type* parent, std::pair<Position, Position> indexes, std::span<const Position> g_list,
+                           Position insertion_target, const pasta::BitVector* bv) {
+        return get_allocator().template new_object<node_type>(_root, parent, std::span<node_type* const>(), indexes, g_list,
+                                                insertion_target, bv);
+    }
+
+    /**
+     * @brief Crea un nuovo nodo nell'arena dell'albero a partire dai fattori che contengono il suffisso.
      *
-     * @return Una referenza costante alla lista di stringhe ICFL.
+     * L'insieme delle occorrenze e' memorizzato in forma densa o sparsa in base alla densita'; come per
+     * l'altra versione, il nodo non viene collegato al genitore.
+     *
+     * @param parent Puntatore al nodo genitore.
+     * @param indexes Coppia di indici che rappresenta l'intervallo associato al nodo.
+     * @param g_list Lista G associata al nodo.
+     * @param insertion_target Punto di inserimento associato al nodo.
+     * @param factors Indici dei fattori che contengono il suffisso, in ordine crescente.
+     * @return Puntatore al nodo creato.
      */
-    const std::list<std::string>& get_icfl() const {
-        return _icfl;
+    node_type* create_node(node_type* parent, std::pair<Position, Position> indexes, std::span<const Position> g_list,
+                           Position insertion_target, std::span<const uint32_t> factors) {
+        return get_allocator().template new_object<node_type>(_root, parent, indexes, g_list, insertion_target, factors,
+                                                _icfl->size());
     }
 
     /**
-     * @brief Imposta il testo del nodo radice con il testo concatenato dell'ICFL fornita.
+     * @brief Restituisce la fattorizzazione ICFL.
      *
-     * Se il testo del nodo radice è già stato impostato, visualizza un messaggio di errore.
+     * @return Una referenza costante alla fattorizzazione ICFL.
+     */
+    const Factorization& get_icfl() const {
+        return *_icfl;
+    }
+
+    /**
+     * @brief Imposta il testo del nodo radice con il testo dell'ICFL fornita.
      *
-     * @param icfl Lista di stringhe che rappresentano l'ICFL.
+     * Se il testo del nodo radice è già stato impostato, visualizza un messaggio di errore. Altrimenti i nodi
+     * esistenti vengono distrutti e l'arena viene sostituita da una nuova, cosi' che la memoria dei nodi
+     * precedenti sia rilasciata invece di restare all'arena monotona.
+     *
+     * @param icfl Fattorizzazione ICFL del testo.
      */
-    void set_text(const std::list<std::string>& icfl) {
+    void set_text(const Factorization& icfl) {
         if(!_root->get_text().empty()) {
             std::cout << "ERROR: text already setted";
             return;
         }
-        _icfl = icfl;
-        std::string text;
-        for (const std::string& factor : icfl) {
-            text += factor;
-        }
-        if (_root) {
-            delete _root;
-        }
-        _root = new Node();
-        _root->set_text(text);
+        destroy_nodes();
+        _arena = std::make_unique<std::pmr::monotonic_buffer_resource>();
+        _icfl = std::make_unique<Factorization>(icfl);
+        _root = get_allocator().template new_object<node_type>();
+        _root->set_text(_icfl->text());
     }
 
     /**
@@ -84,9 +172,12 @@ public:
      *
      * @return Un puntatore costante al nodo radice.
      */
-    Node* get_root() const {
+    node_type* get_root() const {
         return _root;
     }
 };
 
+/// Albero con posizioni a 32 bit, sufficienti per testi fino a 4 GiB.
+using Tree = BasicTree<uint32_t>;
+
 #endif // ICFL_TREE_HPP